@@ -0,0 +1,168 @@
+#include "address.hh"
+#include "eventloop.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface.hh"
+#include "tap_port.hh"
+#include "tun.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t WINDOW = 256; // datagrams in flight (well within the devices' queues of 1000 frames)
+constexpr auto DURATION = seconds { 5 };
+constexpr auto LOSS_TIMEOUT = milliseconds { 20 }; // with nothing arriving for this long, what's in flight is lost
+
+void show_usage( const char* argv0 )
+{
+  cerr << "Usage: " << argv0 << " TAP_A TAP_B [PAYLOAD_SIZE]\n\n"
+       << "Sends datagrams from a NetworkInterface on TAP_A to one on TAP_B for " << DURATION.count()
+       << " seconds, and reports how many frames per second arrive.\n"
+       << "The two devices must be joined by a bridge, e.g. (as root):\n\n"
+       << "    ip tuntap add mode tap user `whoami` name tap144\n"
+       << "    ip tuntap add mode tap user `whoami` name tap145\n"
+       << "    ip link add br144 type bridge\n"
+       << "    ip link set tap144 master br144 up\n"
+       << "    ip link set tap145 master br144 up\n"
+       << "    ip link set br144 up\n";
+}
+
+class TapLoop
+{
+  shared_ptr<TapPort> port_a_;
+  shared_ptr<TapPort> port_b_;
+  NetworkInterface a_;
+  NetworkInterface b_;
+  InternetDatagram dgram_ {};
+  vector<NetworkInterface::OutboundDatagram> burst_ {};
+  EventLoop loop_ {};
+
+  uint64_t sent_ {};
+  uint64_t received_ {};
+  uint64_t lost_ {};
+  steady_clock::time_point last_tick_ { steady_clock::now() };
+
+  void receive_on_b()
+  {
+    port_b_->receive( b_ );
+    auto& inbound = b_.datagrams_received();
+    while ( not inbound.empty() ) {
+      inbound.pop();
+      ++received_;
+    }
+  }
+
+  void send_burst( const size_t count )
+  {
+    burst_.assign( count, { dgram_, dgram_.header.dst } );
+    a_.send_datagrams( burst_ );
+    sent_ += count;
+  }
+
+  // Wait for something to arrive, keeping the interfaces' clocks up to date. Returns false on a timeout.
+  bool wait()
+  {
+    const auto result = loop_.wait_next_event( duration_cast<nanoseconds>( LOSS_TIMEOUT ) );
+    if ( result == EventLoop::Result::Exit ) {
+      throw runtime_error( "the TAP devices went away" );
+    }
+    const auto now = steady_clock::now();
+    const auto elapsed = duration_cast<microseconds>( now - last_tick_ );
+    last_tick_ = now;
+    a_.tick( elapsed );
+    b_.tick( elapsed );
+    return result != EventLoop::Result::Timeout;
+  }
+
+public:
+  TapLoop( const string& dev_a, const string& dev_b, const size_t payload_size )
+    : port_a_( make_shared<TapPort>( TapFD { dev_a } ) )
+    , port_b_( make_shared<TapPort>( TapFD { dev_b } ) )
+    , a_( "a", port_a_, { 0x02, 0, 0, 0, 0x01, 0x44 }, Address { "10.144.0.1" } )
+    , b_( "b", port_b_, { 0x02, 0, 0, 0, 0x01, 0x45 }, Address { "10.144.0.2" } )
+  {
+    dgram_.header.src = Address { "10.144.0.1" }.ipv4_numeric();
+    dgram_.header.dst = Address { "10.144.0.2" }.ipv4_numeric();
+    dgram_.payload.emplace_back( string( payload_size, 'x' ) );
+    dgram_.header.len = static_cast<uint16_t>( dgram_.header.hlen * 4 + payload_size );
+    dgram_.header.compute_checksum();
+
+    loop_.add_rule( "receive on " + dev_a, port_a_->fd(), Direction::In, [&] { port_a_->receive( a_ ); } );
+    loop_.add_rule( "receive on " + dev_b, port_b_->fd(), Direction::In, [&] { receive_on_b(); } );
+  }
+
+  void run()
+  {
+    // resolve b's address before timing anything
+    send_burst( 1 );
+    for ( const auto give_up = steady_clock::now() + seconds { 2 }; received_ == 0; ) {
+      if ( steady_clock::now() > give_up ) {
+        throw runtime_error( "nothing got across (are the devices up, and bridged?)" );
+      }
+      wait();
+    }
+
+    const auto start = steady_clock::now();
+    const auto start_stats = port_b_->stats();
+    sent_ = received_ = 0;
+    while ( steady_clock::now() - start < DURATION ) {
+      const uint64_t in_flight = sent_ - received_ - lost_;
+      if ( in_flight < WINDOW ) {
+        send_burst( min( WINDOW - in_flight, TapPort::MAX_BURST ) );
+      }
+      if ( not wait() ) {
+        lost_ = sent_ - received_;
+      }
+    }
+    const auto elapsed = duration_cast<duration<double>>( steady_clock::now() - start );
+    const auto& stats = port_b_->stats();
+
+    cout << fixed << setprecision( 0 ) << "Frames of " << dgram_.header.len + EthernetHeader::LENGTH
+         << " bytes from " << a_.name() << " to " << b_.name() << ": " << setw( 9 )
+         << static_cast<double>( received_ ) / elapsed.count() << " frames/s, " << lost_ << " of " << sent_
+         << " lost, " << setprecision( 2 )
+         << static_cast<double>( stats.frames_received - start_stats.frames_received )
+              / static_cast<double>( stats.bursts - start_stats.bursts )
+         << " frames per wakeup\n";
+  }
+};
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort(); // For sticklers: don't try to access argv[0] if argc <= 0.
+    }
+
+    auto args = span( argv, argc );
+    if ( argc != 3 and argc != 4 ) {
+      show_usage( args.front() );
+      return EXIT_FAILURE;
+    }
+
+    const size_t payload_size = argc == 4 ? stoul( args[3] ) : 64;
+    if ( payload_size + IPv4Header::LENGTH > TapPort::MAX_FRAME_SIZE - EthernetHeader::LENGTH ) {
+      throw runtime_error( "payload too large for a 1500-byte MTU" );
+    }
+
+    TapLoop { args[1], args[2], payload_size }.run();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
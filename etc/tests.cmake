@@ -58,6 +58,14 @@ ttest(net_interface)
 
 ttest(router)
 
+ttest(header_roundtrip)
+
+ttest(netem)
+
+ttest(shared_byte_ring)
+
+ttest(checksum)
+
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R 'webget|^byte_stream_')
 
 add_custom_target (check_webget COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 12 -R 'webget')
@@ -90,3 +98,9 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(tcp_speed_test)
+stest(checksum_speed_test)
+stest(parse_speed_test)
+stest(neighbor_speed_test)
+stest(router_speed_test)
+stest(route_speed_test)
@@ -21,9 +21,14 @@ void Writer::push( string data )
   auto len = data.size();
   auto push_len = min( available_capacity(), len );
   if ( push_len > 0 ) {
-    real_queue.emplace_back( data.substr( 0, push_len ) );
-    string& top_str = real_queue.back();
-    view_queue.emplace_back( top_str );
+    data.resize( push_len );
+    // Don't let a chunk pin an allocation much larger than itself (e.g. a read buffer sized for the whole
+    // capacity): slices of it may be kept until they are acknowledged
+    if ( data.capacity() > 2 * push_len ) {
+      data.shrink_to_fit();
+      Buffer::record_copy( push_len );
+    }
+    real_queue.emplace_back( std::move( data ) );
     buffered_ += push_len;
     bytes_pushed_ += push_len;
   }
@@ -57,7 +62,16 @@ uint64_t Reader::bytes_popped() const
 string_view Reader::peek() const
 {
   if ( buffered_ > 0 ) {
-    return view_queue.front();
+    return real_queue.front();
+  } else {
+    return {};
+  }
+}
+
+Buffer Reader::peek_buffer() const
+{
+  if ( buffered_ > 0 ) {
+    return real_queue.front();
   } else {
     return {};
   }
@@ -66,14 +80,13 @@ string_view Reader::peek() const
 void Reader::pop( uint64_t len )
 {
   while ( len > 0 && buffered_ > 0 ) {
-    string_view& view_str = view_queue.front();
-    auto len_str = view_str.size();
+    Buffer& front = real_queue.front();
+    auto len_str = front.size();
     auto len_pop = min( len, len_str );
     if ( len >= len_str ) {
-      view_queue.pop_front();
       real_queue.pop_front();
     } else {
-      view_str.remove_prefix( len );
+      front.remove_prefix( len );
     }
     buffered_ -= len_pop;
     bytes_popped_ += len_pop;
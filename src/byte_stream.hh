@@ -1,5 +1,7 @@
 #pragma once
 
+#include "buffer.hh"
+
 #include <cstdint>
 #include <deque>
 #include <string>
@@ -32,8 +34,7 @@ protected:
   uint64_t buffered_ {};
   uint64_t bytes_pushed_ {};
   uint64_t bytes_popped_ {};
-  deque<string> real_queue {};
-  deque<string_view> view_queue {};
+  deque<Buffer> real_queue {}; // chunks as pushed; popping slices the front one instead of copying it
 };
 
 class Writer : public ByteStream
@@ -51,6 +52,7 @@ class Reader : public ByteStream
 {
 public:
   std::string_view peek() const; // Peek at the next bytes in the buffer
+  Buffer peek_buffer() const;     // Same, but sharing the bytes (so they outlive a pop) instead of viewing them
   void pop( uint64_t len );      // Remove `len` bytes from the buffer
 
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
@@ -63,3 +65,8 @@ public:
  * from a ByteStream Reader into a string;
  */
 void read( Reader& reader, uint64_t len, std::string& out );
+
+/*
+ * Same, but into a Buffer: when the bytes lie in one pushed chunk, `out` shares them instead of copying them.
+ */
+void read( Reader& reader, uint64_t len, Buffer& out );
@@ -1,5 +1,7 @@
 #include "byte_stream.hh"
+#include "checksum.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <stdexcept>
 
@@ -24,6 +26,28 @@ void read( Reader& reader, uint64_t len, std::string& out )
   }
 }
 
+void read( Reader& reader, uint64_t len, Buffer& out )
+{
+  const Buffer front = reader.peek_buffer();
+  if ( front.size() >= std::min( len, reader.bytes_buffered() ) ) {
+    out = front.substr( 0, len );
+    reader.pop( out.size() );
+    return;
+  }
+
+  // The bytes span chunks, so they have to be gathered into one. Sum them on the way, for the TCP checksum.
+  std::string gathered( std::min( len, reader.bytes_buffered() ), 0 );
+  InternetChecksum sum;
+  for ( size_t filled = 0; filled < gathered.size(); ) {
+    const auto view = reader.peek().substr( 0, gathered.size() - filled );
+    sum.add_copy( gathered.data() + filled, view );
+    reader.pop( view.size() );
+    filled += view.size();
+  }
+  Buffer::record_copy( gathered.size() );
+  out = Buffer { std::move( gathered ), static_cast<uint16_t>( ~sum.value() ) };
+}
+
 Reader& ByteStream::reader()
 {
   static_assert( sizeof( Reader ) == sizeof( ByteStream ),
@@ -0,0 +1,79 @@
+#include "fib.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// Why the ordering works (all of the atomics' operations are sequentially consistent): an update stores current_,
+// then version_, then reads the readers' slots. A reader that stores a version number in its slot read it from
+// version_, and will load current_ only after the store. So the version retired when version N was published
+// can't be in use by a reader whose slot shows N or later, and a reader whose slot the update saw as offline will
+// load current_ only after it was updated.
+
+Fib::Reader::~Reader()
+{
+  slot_->seen = OFFLINE;
+  slot_->in_use = false;
+}
+
+Fib::Fib() : current_(), version_( 1 ), latest_( make_unique<const Version>( Version { {}, 1 } ) )
+{
+  current_ = latest_.get();
+  stats_.published = 1;
+}
+
+Fib::~Fib() = default;
+
+Fib::Reader Fib::reader()
+{
+  for ( auto& slot : slots_ ) {
+    bool in_use = false;
+    if ( slot.in_use.compare_exchange_strong( in_use, true ) ) {
+      return { *this, slot };
+    }
+  }
+  throw runtime_error( "Fib: more than " + to_string( MAX_READERS ) + " readers" );
+}
+
+uint64_t Fib::update( const function<void( RouteTable& )>& change )
+{
+  const lock_guard lock { update_mutex_ };
+  auto next = make_unique<Version>( Version { latest_->table, latest_->number + 1 } );
+  change( next->table );
+
+  current_ = next.get();
+  version_ = next->number;
+  retired_.push_back( std::move( latest_ ) );
+  latest_ = std::move( next );
+  ++stats_.published;
+
+  reclaim_locked();
+  return latest_->number;
+}
+
+void Fib::reclaim()
+{
+  const lock_guard lock { update_mutex_ };
+  reclaim_locked();
+}
+
+void Fib::reclaim_locked()
+{
+  uint64_t oldest_seen = OFFLINE;
+  for ( const auto& slot : slots_ ) {
+    oldest_seen = min( oldest_seen, slot.seen.load() );
+  }
+
+  // a version was retired when the next was published, so it's free once every reader has seen that one
+  const auto in_use = ranges::find_if( retired_, [&]( const auto& v ) { return v->number + 1 > oldest_seen; } );
+  stats_.reclaimed += static_cast<uint64_t>( in_use - retired_.begin() );
+  retired_.erase( retired_.begin(), in_use );
+}
+
+Fib::Stats Fib::stats() const
+{
+  const lock_guard lock { update_mutex_ };
+  return { stats_.published, stats_.reclaimed, retired_.size() };
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "route_table.hh"
+
+// A forwarding information base: the RouteTable that forwarding threads look routes up in while a control plane
+// changes it, read-copy-update style. Each change is made to a copy of the current table (which shares all the
+// storage the change doesn't write to; see RouteTable) and published in its place with one atomic store, so
+// lookups never wait for an update, and never see one half made. The version it replaces is retired, and freed
+// once every reader has been through a quiescent state since (a point, such as between bursts of datagrams, where
+// it holds nothing it got from the Fib).
+//
+// Each forwarding thread registers a Reader, which starts offline. Online, it may use the current() version until
+// its next quiescent(); going offline() (while it's idle) is a quiescent state that lasts until it's online()
+// again. A Reader::Section keeps it online for a scope. Updates may come from any thread, and are applied one at a
+// time.
+class Fib
+{
+public:
+  static constexpr size_t MAX_READERS = 64;
+
+  struct Version
+  {
+    RouteTable table;
+    uint64_t number; // (the first, empty, table is version 1, and each update makes the next)
+  };
+
+  struct Stats
+  {
+    uint64_t published; // versions
+    uint64_t reclaimed;
+    size_t retired; // versions waiting to be reclaimed
+  };
+
+private:
+  static constexpr uint64_t OFFLINE = std::numeric_limits<uint64_t>::max();
+
+  struct alignas( 64 ) Slot // (one per cache line, since each is written by a different thread)
+  {
+    std::atomic<bool> in_use {};
+    std::atomic<uint64_t> seen { OFFLINE }; // the latest version published as of the reader's last quiescent state
+  };
+
+public:
+  class Reader
+  {
+  public:
+    ~Reader();
+    Reader( const Reader& ) = delete;
+    Reader& operator=( const Reader& ) = delete;
+
+    void online() { quiescent(); }
+    void offline() { slot_->seen = OFFLINE; }
+    void quiescent() { slot_->seen = fib_->version_.load(); }
+
+    // The latest version (only while online)
+    const Version& current() const { return *fib_->current_; }
+
+    // Online for as long as it lives, and offline again when it goes (even if by an exception)
+    class Section
+    {
+    public:
+      explicit Section( Reader& reader ) : reader_( &reader ) { reader_->online(); }
+      ~Section() { reader_->offline(); }
+      Section( const Section& ) = delete;
+      Section& operator=( const Section& ) = delete;
+
+    private:
+      Reader* reader_;
+    };
+
+  private:
+    friend class Fib;
+    Reader( const Fib& fib, Slot& slot ) : fib_( &fib ), slot_( &slot ) {}
+
+    const Fib* fib_;
+    Slot* slot_;
+  };
+
+  Fib();
+  ~Fib(); // (after all its readers are gone)
+  Fib( const Fib& ) = delete;
+  Fib& operator=( const Fib& ) = delete;
+
+  // Throws if MAX_READERS are already registered
+  Reader reader();
+
+  // Make a new version of the table with `change` (which may throw, leaving the current one as it is), publish
+  // it, and reclaim what can be. Returns the new version's number.
+  uint64_t update( const std::function<void( RouteTable& )>& change );
+
+  // Free the retired versions that no reader can be using any more
+  void reclaim();
+
+  Stats stats() const;
+
+private:
+  std::atomic<const Version*> current_;
+  std::atomic<uint64_t> version_; // current_'s number, stored after it
+  std::array<Slot, MAX_READERS> slots_ {};
+
+  mutable std::mutex update_mutex_ {}; // (for all that follows)
+  std::unique_ptr<const Version> latest_; // (what current_ points to)
+  std::vector<std::unique_ptr<const Version>> retired_ {}; // oldest first
+  Stats stats_ {};
+
+  void reclaim_locked();
+};
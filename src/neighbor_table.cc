@@ -0,0 +1,107 @@
+#include "neighbor_table.hh"
+
+#include <utility>
+
+using namespace std;
+
+// Fibonacci hashing: the top bits of the address times 2^64 / phi
+size_t NeighborTable::home( const uint32_t ip_address ) const
+{
+  return static_cast<size_t>( ( uint64_t { ip_address } * 0x9e3779b97f4a7c15 ) >> ( 64 - bits_ ) );
+}
+
+NeighborTable::Neighbor* NeighborTable::find( const uint32_t ip_address )
+{
+  if ( keys_.empty() ) {
+    return nullptr;
+  }
+  for ( size_t i = home( ip_address );; i = ( i + 1 ) & mask() ) {
+    if ( keys_[i] == ip_address ) {
+      return ip_address == EMPTY ? nullptr : &neighbors_[i];
+    }
+    if ( keys_[i] == EMPTY ) {
+      return nullptr;
+    }
+  }
+}
+
+NeighborTable::Neighbor* NeighborTable::insert( const uint32_t ip_address )
+{
+  if ( size_ >= MAX_NEIGHBORS or ip_address == EMPTY ) {
+    return nullptr;
+  }
+  if ( ( size_ + 1 ) * 2 > keys_.size() ) {
+    grow();
+  }
+  size_t i = home( ip_address );
+  while ( keys_[i] != EMPTY ) {
+    i = ( i + 1 ) & mask();
+  }
+  keys_[i] = ip_address;
+  neighbors_[i] = { .ip_address = ip_address };
+  ++size_;
+  return &neighbors_[i];
+}
+
+void NeighborTable::grow()
+{
+  bits_ = keys_.empty() ? 4 : bits_ + 1;
+  const vector<uint32_t> old_keys = exchange( keys_, vector<uint32_t>( size_t { 1 } << bits_, EMPTY ) );
+  const vector<Neighbor> old_neighbors = exchange( neighbors_, vector<Neighbor>( keys_.size() ) );
+  for ( size_t j = 0; j < old_keys.size(); ++j ) {
+    if ( old_keys[j] != EMPTY ) {
+      size_t i = home( old_keys[j] );
+      while ( keys_[i] != EMPTY ) {
+        i = ( i + 1 ) & mask();
+      }
+      keys_[i] = old_keys[j];
+      neighbors_[i] = old_neighbors[j];
+    }
+  }
+}
+
+// Linear probing without tombstones: after emptying a slot, move later entries of the same probe run back into
+// the hole whenever their home slot isn't between the hole and where they are
+void NeighborTable::erase( Neighbor& neighbor )
+{
+  while ( neighbor.pending_count ) {
+    pop_pending( neighbor );
+  }
+
+  size_t hole = static_cast<size_t>( &neighbor - neighbors_.data() );
+  keys_[hole] = EMPTY;
+  neighbors_[hole] = {};
+  --size_;
+  for ( size_t i = ( hole + 1 ) & mask(); keys_[i] != EMPTY; i = ( i + 1 ) & mask() ) {
+    const size_t distance = ( i - home( keys_[i] ) ) & mask();
+    if ( distance >= ( ( i - hole ) & mask() ) ) {
+      keys_[hole] = exchange( keys_[i], EMPTY );
+      neighbors_[hole] = exchange( neighbors_[i], {} );
+      hole = i;
+    }
+  }
+}
+
+void NeighborTable::push_pending( Neighbor& neighbor, const InternetDatagram& dgram )
+{
+  uint16_t index {};
+  if ( free_.empty() ) {
+    index = static_cast<uint16_t>( pool_.size() );
+    pool_.push_back( dgram );
+  } else {
+    index = free_.back();
+    free_.pop_back();
+    pool_[index] = dgram;
+  }
+  neighbor.pending.at( ( neighbor.pending_head + neighbor.pending_count ) % MAX_PENDING_PER_NEIGHBOR ) = index;
+  ++neighbor.pending_count;
+}
+
+InternetDatagram NeighborTable::pop_pending( Neighbor& neighbor )
+{
+  const uint16_t index = neighbor.pending.at( neighbor.pending_head );
+  neighbor.pending_head = static_cast<uint8_t>( ( neighbor.pending_head + 1 ) % MAX_PENDING_PER_NEIGHBOR );
+  --neighbor.pending_count;
+  free_.push_back( index );
+  return exchange( pool_[index], {} );
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+
+// The ARP state of a NetworkInterface: what it knows about each neighbor (an IP address on the link), in one
+// flat open-addressing hash table keyed by IPv4 address. An entry holds the neighbor's Ethernet address and
+// timestamps inline, plus a small ring of the datagrams waiting for it (as indices into a pool shared by the
+// whole table). The keys are kept in an array of their own, so resolving a next hop is one probe sequence over
+// adjacent 4-byte keys followed by a single access to its entry.
+class NeighborTable
+{
+public:
+  static constexpr size_t MAX_NEIGHBORS = 16384;
+  static constexpr size_t MAX_PENDING_PER_NEIGHBOR = 16;
+  static constexpr size_t MAX_PENDING = 256; // in the whole table
+
+  struct Neighbor
+  {
+    uint32_t ip_address {};
+    bool mapped {};     // the neighbor's Ethernet address (`header.dst`) was learned at `learned`
+    bool requesting {}; // an ARP request (the `retries`th resend of one) has been outstanding since `request_sent`
+    uint8_t retries {};
+    EthernetHeader header {}; // for IPv4 frames to the neighbor, prebuilt when its address is learned
+    uint8_t pending_head {};
+    uint8_t pending_count {};
+    std::chrono::microseconds learned {};
+    std::chrono::microseconds refresh {}; // when to (next) ask the neighbor to confirm the mapping
+    std::chrono::microseconds request_sent {};
+    std::array<uint16_t, MAX_PENDING_PER_NEIGHBOR> pending {}; // pool indices, oldest at `pending_head`
+  };
+
+  Neighbor* find( uint32_t ip_address );
+
+  // Add an entry for a neighbor that isn't in the table (or return nullptr if the table is full, or the address is
+  // the limited broadcast address, which is never a neighbor).
+  // May move other entries, invalidating pointers to them.
+  Neighbor* insert( uint32_t ip_address );
+
+  // Remove an entry, dropping its pending datagrams. May move other entries, invalidating pointers to them.
+  void erase( Neighbor& neighbor );
+
+  size_t size() const { return size_; }
+
+  // Datagrams waiting for their next hop to be resolved
+  size_t pending_count() const { return pool_.size() - free_.size(); }
+  bool pending_full() const { return pending_count() == MAX_PENDING; }
+
+  // Queue a datagram behind the neighbor's others (there must be room, both for the neighbor and in the pool)
+  void push_pending( Neighbor& neighbor, const InternetDatagram& dgram );
+
+  // Take the neighbor's oldest pending datagram (there must be one)
+  InternetDatagram pop_pending( Neighbor& neighbor );
+
+private:
+  static constexpr uint32_t EMPTY = 0xffffffff; // key of an unused slot
+
+  std::vector<uint32_t> keys_ {};     // empty, or a power of two long and at most half full
+  std::vector<Neighbor> neighbors_ {}; // parallel to `keys_`
+  unsigned bits_ {};                   // log2 of the number of slots
+  size_t size_ {};
+  std::vector<InternetDatagram> pool_ {};
+  std::vector<uint16_t> free_ {}; // unused indices into `pool_`
+
+  static_assert( MAX_PENDING <= UINT16_MAX and MAX_PENDING_PER_NEIGHBOR <= UINT8_MAX );
+
+  size_t home( uint32_t ip_address ) const;
+  size_t mask() const { return keys_.size() - 1; }
+  void grow();
+};
@@ -27,40 +27,71 @@ NetworkInterface::NetworkInterface( string_view name,
 //! can be converted to a uint32_t (raw 32-bit IP address) by using the Address::ipv4_numeric() method.
 void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
 {
-  // get next_hop ip address
-  uint32_t ip_numeric = next_hop.ipv4_numeric();
-  auto it_res = map_ip_.find( ip_numeric );
-  EthernetFrame frame {};
+  send_to( dgram, next_hop.ipv4_numeric() );
+}
+
+void NetworkInterface::send_datagrams( span<OutboundDatagram> datagrams )
+{
+  const bool outermost = begin_batch();
+  for ( auto& [dgram, next_hop] : datagrams ) {
+    send_to( std::move( dgram ), next_hop );
+  }
+  if ( outermost ) {
+    end_batch();
+  }
+}
+
+// (pass the datagram as an rvalue to move its payload into the frame)
+template<typename T>
+void NetworkInterface::send_to( T&& dgram, const uint32_t ip_numeric )
+{
+  auto* neighbor = neighbors_.find( ip_numeric );
   // if not learning arp mapping or arp mapping timeout
-  if ( it_res == map_ip_.end() || cur_time_ - it_res->second.learning_time_ >= ARP_TIMEOUT_ ) {
-    // cannot find phy address, queue frame, and send arp request
-    map_queue_[ip_numeric].push( dgram );
-    // check if arp request too frequently
-    auto it_send_res = map_send_time_.find( ip_numeric );
-    if ( it_send_res != map_send_time_.end() ) {
-      if ( cur_time_ - it_send_res->second <= ARP_INTERVAL_ )
-        return;
-    } else {
-      map_send_time_[ip_numeric] = cur_time_;
+  if ( !neighbor || !neighbor->mapped || cur_time_ - neighbor->learned >= ARP_TIMEOUT_ ) {
+    if ( !neighbor && !( neighbor = track( ip_numeric ) ) ) {
+      ++arp_stats_.table_full_drops;
+      return;
     }
-    auto ARP_msg = genArpEthernetFrame( ARPMessage::OPCODE_REQUEST,
-                                        ethernet_address_,
-                                        { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
-                                        ip_address_.ipv4_numeric(),
-                                        ip_numeric );
-    datagramToEthernetFrame<ARPMessage>(
-      frame, ARP_msg, ETHERNET_BROADCAST, ethernet_address_, EthernetHeader::TYPE_ARP );
-  } else {
-    // ipv4 dgram
-    datagramToEthernetFrame<InternetDatagram>(
-      frame, dgram, it_res->second.mac_addr_, ethernet_address_, EthernetHeader::TYPE_IPv4 );
+    // cannot find phy address, queue frame, and send arp request (unless one is outstanding: tick() resends it)
+    queue_datagram( *neighbor, dgram );
+    if ( !neighbor->requesting ) {
+      neighbor->requesting = true;
+      neighbor->retries = 0;
+      neighbor->request_sent = cur_time_;
+      send_arp_request( ip_numeric, ETHERNET_BROADCAST );
+    }
+    return;
+  }
+  // mapping about to expire: ask the neighbor to confirm it (after sending the datagram, by which time the port
+  // may have delivered something back to this interface, and moved `neighbor`)
+  const EthernetHeader header = neighbor->header;
+  const bool refresh = cur_time_ >= neighbor->refresh;
+  if ( refresh ) {
+    neighbor->refresh = cur_time_ + ARP_PROBE_INTERVAL_;
   }
-  // transmit
-  transmit( frame );
+  // ipv4 dgram
+  EthernetFrame frame {};
+  encapsulate( frame, std::forward<T>( dgram ), header );
+  transmit( std::move( frame ) );
+  if ( refresh ) {
+    send_arp_request( ip_numeric, header.dst );
+  }
+}
+
+void NetworkInterface::send_arp_request( const uint32_t ip_address, const EthernetAddress& dst )
+{
+  auto ARP_msg = genArpEthernetFrame( ARPMessage::OPCODE_REQUEST,
+                                      ethernet_address_,
+                                      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+                                      ip_address_.ipv4_numeric(),
+                                      ip_address );
+  EthernetFrame frame {};
+  datagramToEthernetFrame( frame, ARP_msg, dst, ethernet_address_, EthernetHeader::TYPE_ARP );
+  transmit( std::move( frame ) );
 }
 
 //! \param[in] frame the incoming Ethernet frame
-void NetworkInterface::recv_frame( const EthernetFrame& frame )
+void NetworkInterface::recv_frame( EthernetFrame&& frame )
 {
   auto& header = frame.header;
   // check receive
@@ -68,11 +99,13 @@ void NetworkInterface::recv_frame( const EthernetFrame& frame )
   if ( dst != ethernet_address_ && dst != ETHERNET_BROADCAST ) {
     return;
   }
-  auto& payload = frame.payload;
-  Parser parser( payload );
+  // (a datagram that arrives in one piece keeps it, to be forwarded in)
+  Buffer wire = frame.payload.size() == 1 ? frame.payload.front() : Buffer {};
+  Parser parser( std::move( frame.payload ) );
   if ( header.type == EthernetHeader::TYPE_IPv4 ) {
     // ipv4 dgram push into queue
     InternetDatagram dgram {};
+    dgram.wire = std::move( wire );
     dgram.parse( parser );
     if ( !parser.has_error() ) {
       datagrams_received_.push( std::move( dgram ) );
@@ -91,22 +124,154 @@ void NetworkInterface::recv_frame( const EthernetFrame& frame )
                                                       ip_address_.ipv4_numeric(),
                                                       arpMessage.sender_ip_address );
         EthernetFrame replyFrame {};
-        datagramToEthernetFrame<ARPMessage>( replyFrame,
+        datagramToEthernetFrame( replyFrame,
                                              arpReplyMsg,
                                              arpMessage.sender_ethernet_address,
                                              ethernet_address_,
                                              EthernetHeader::TYPE_ARP );
-        transmit( replyFrame );
+        transmit( std::move( replyFrame ) );
       }
-      map_ip_[arpMessage.sender_ip_address]
-        = { .mac_addr_ = arpMessage.sender_ethernet_address, .learning_time_ = cur_time_ };
-      transmitDgramInQueue( arpMessage.sender_ip_address, arpMessage.sender_ethernet_address );
+      learn( arpMessage.sender_ip_address, arpMessage.sender_ethernet_address );
     }
   }
 }
 
-//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
-void NetworkInterface::tick( const size_t ms_since_last_tick )
+void NetworkInterface::recv_frames( span<EthernetFrame> frames )
+{
+  const bool outermost = begin_batch();
+  for ( auto& frame : frames ) {
+    recv_frame( std::move( frame ) );
+  }
+  if ( outermost ) {
+    end_batch();
+  }
+}
+
+void NetworkInterface::transmit( EthernetFrame&& frame )
+{
+  if ( batching_ ) {
+    transmit_batch_.push_back( std::move( frame ) );
+  } else {
+    port_->transmit( *this, frame );
+  }
+}
+
+// The port may deliver the frames straight to another interface whose response comes back to this one, so the
+// batch is taken out (and batching stopped) before the port sees it
+void NetworkInterface::end_batch()
+{
+  batching_ = false;
+  if ( transmit_batch_.empty() ) {
+    return;
+  }
+  auto frames = std::exchange( transmit_batch_, {} );
+  port_->transmit_batch( *this, frames );
+  frames.clear();
+  if ( transmit_batch_.empty() ) {
+    transmit_batch_ = std::move( frames ); // keep its capacity
+  }
+}
+
+//! \param[in] time_since_last_tick the time elapsed since the last call to this method
+void NetworkInterface::tick( const chrono::microseconds time_since_last_tick )
+{
+  cur_time_ += time_since_last_tick;
+  age_neighbors();
+}
+
+void NetworkInterface::learn( const uint32_t ip_address, const EthernetAddress& mac )
+{
+  auto* neighbor = neighbors_.find( ip_address );
+  if ( !neighbor && !( neighbor = track( ip_address ) ) ) {
+    return;
+  }
+  neighbor->mapped = true;
+  neighbor->header = { .dst = mac, .src = ethernet_address_, .type = EthernetHeader::TYPE_IPv4 };
+  neighbor->learned = cur_time_;
+  neighbor->refresh = cur_time_ + ARP_TIMEOUT_ - ARP_REFRESH_;
+  neighbor->requesting = false;
+  transmitDgramInQueue( *neighbor );
+}
+
+// Queue a datagram until its next hop is resolved. If the next hop's queue is full, its oldest datagram makes way
+// for the new one; if all the queues together are full, the new datagram is dropped.
+void NetworkInterface::queue_datagram( NeighborTable::Neighbor& neighbor, const InternetDatagram& dgram )
+{
+  if ( neighbor.pending_count >= NeighborTable::MAX_PENDING_PER_NEIGHBOR ) {
+    neighbors_.pop_pending( neighbor );
+    ++arp_stats_.queue_full_drops;
+  } else if ( neighbors_.pending_full() ) {
+    ++arp_stats_.table_full_drops;
+    return;
+  }
+  neighbors_.push_pending( neighbor, dgram );
+}
+
+chrono::microseconds NetworkInterface::expiry( const NeighborTable::Neighbor& neighbor )
+{
+  chrono::microseconds ret {};
+  if ( neighbor.mapped ) {
+    ret = neighbor.learned + ARP_TIMEOUT_;
+  }
+  if ( neighbor.requesting ) {
+    ret = max( ret, neighbor.request_sent + request_timeout( neighbor ) );
+  }
+  return ret;
+}
+
+// A next hop is on the wheel exactly once while it is in the table. Its state only ever expires later than it
+// would have when it was put there (a mapping is relearned, or a request resent), so rather than moving it, the
+// wheel checks again when the slot comes round. (That's also when an unanswered request is resent: a request is
+// only made once any mapping has expired, so its timeout is the next hop's expiry.)
+NeighborTable::Neighbor* NetworkInterface::track( const uint32_t ip_address )
+{
+  auto* neighbor = neighbors_.insert( ip_address );
+  if ( neighbor ) {
+    schedule( ip_address, cur_time_ + ARP_INTERVAL_ ); // the soonest any new state expires
+  }
+  return neighbor;
+}
+
+void NetworkInterface::schedule( const uint32_t ip_address, const chrono::microseconds when )
+{
+  wheel_[static_cast<uint64_t>( when / WHEEL_SLOT_ ) % WHEEL_SLOTS_].push_back( ip_address );
+}
+
+void NetworkInterface::forget( NeighborTable::Neighbor& neighbor )
 {
-  cur_time_ += ms_since_last_tick;
+  if ( neighbor.mapped ) {
+    ++arp_stats_.expired_mappings;
+  }
+  arp_stats_.unresolved_drops += neighbor.pending_count;
+  neighbors_.erase( neighbor );
+}
+
+void NetworkInterface::age_neighbors()
+{
+  const auto now_slot = static_cast<uint64_t>( cur_time_ / WHEEL_SLOT_ );
+  // (after a long tick, each slot is visited once)
+  uint64_t slot = max( wheel_slot_, now_slot + 1 > WHEEL_SLOTS_ ? now_slot + 1 - WHEEL_SLOTS_ : 0 );
+  for ( ; slot <= now_slot; ++slot ) {
+    wheel_due_.swap( wheel_[slot % WHEEL_SLOTS_] );
+    for ( const uint32_t ip_address : wheel_due_ ) {
+      auto* neighbor = neighbors_.find( ip_address );
+      const auto when = expiry( *neighbor );
+      if ( when > cur_time_ ) {
+        schedule( ip_address, when );
+        continue;
+      }
+      if ( neighbor->requesting && neighbor->retries < MAX_ARP_RETRIES_ ) {
+        ++neighbor->retries;
+        neighbor->request_sent = cur_time_;
+        schedule( ip_address, expiry( *neighbor ) );
+        // (last: the port may deliver the reply, and more, straight back to this interface, and move `neighbor`)
+        send_arp_request( ip_address, ETHERNET_BROADCAST );
+      } else {
+        forget( *neighbor );
+      }
+    }
+    wheel_due_.clear();
+  }
+  // the current slot is visited again on the next tick, as more of it passes
+  wheel_slot_ = now_slot;
 }
@@ -1,16 +1,20 @@
 #pragma once
 
+#include <chrono>
 #include <concepts>
 #include <iomanip>
 #include <queue>
+#include <span>
 #include <sstream>
-#include <unordered_map>
+#include <type_traits>
+#include <vector>
 
 #include "address.hh"
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
 #include "ethernet_header.hh"
 #include "ipv4_datagram.hh"
+#include "neighbor_table.hh"
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -48,6 +52,15 @@ public:
   {
   public:
     virtual void transmit( const NetworkInterface& sender, const EthernetFrame& frame ) = 0;
+
+    // Send a burst of frames, in order (by default, one at a time)
+    virtual void transmit_batch( const NetworkInterface& sender, std::span<const EthernetFrame> frames )
+    {
+      for ( const auto& frame : frames ) {
+        transmit( sender, frame );
+      }
+    }
+
     virtual ~OutputPort() = default;
   };
 
@@ -63,14 +76,33 @@ public:
   // hop. Sending is accomplished by calling `transmit()` (a member variable) on the frame.
   void send_datagram( const InternetDatagram& dgram, const Address& next_hop );
 
+  // A datagram to send, and the numeric IP address of its next hop
+  struct OutboundDatagram
+  {
+    InternetDatagram dgram;
+    uint32_t next_hop;
+  };
+
+  // Sends a burst of datagrams (moving their payloads into the frames). The frames that result, including any ARP
+  // requests, are handed to the output port together, with one call to `transmit_batch()`.
+  void send_datagrams( std::span<OutboundDatagram> datagrams );
+
   // Receives an Ethernet frame and responds appropriately.
   // If type is IPv4, pushes the datagram to the datagrams_in queue.
   // If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
   // If type is ARP reply, learn a mapping from the "sender" fields.
-  void recv_frame( const EthernetFrame& frame );
+  // The rvalue version takes ownership of the frame's payload, so the datagram's payload is moved out of it
+  // rather than copied.
+  void recv_frame( EthernetFrame&& frame );
+  void recv_frame( const EthernetFrame& frame ) { recv_frame( EthernetFrame { frame } ); }
+
+  // Receives a burst of frames (taking ownership of their payloads). Any frames sent in response are handed to the
+  // output port together, as with `send_datagrams()`.
+  void recv_frames( std::span<EthernetFrame> frames );
 
   // Called periodically when time elapses
-  void tick( size_t ms_since_last_tick );
+  void tick( std::chrono::microseconds time_since_last_tick );
+  void tick( size_t ms_since_last_tick ) { tick( std::chrono::milliseconds { ms_since_last_tick } ); }
 
   // Accessors
   const std::string& name() const { return name_; }
@@ -78,12 +110,19 @@ public:
   OutputPort& output() { return *port_; }
   std::queue<InternetDatagram>& datagrams_received() { return datagrams_received_; }
 
-  // ethernet address and timeout
-  struct MacAddrUnit
+  // Datagrams dropped while waiting for ARP, and mappings aged out
+  struct ARPStats
   {
-    EthernetAddress mac_addr_ {};
-    uint64_t learning_time_ {};
+    uint64_t queue_full_drops {}; // the queue for one next hop was full (so its oldest datagram was dropped)
+    uint64_t table_full_drops {}; // every pending-datagram (or next-hop) slot was in use
+    uint64_t unresolved_drops {}; // still queued when the ARP request timed out
+    uint64_t expired_mappings {};
   };
+  const ARPStats& arp_stats() const { return arp_stats_; }
+
+  // Next hops with any ARP state (a mapping or an outstanding request), and datagrams queued for them
+  size_t neighbor_count() const { return neighbors_.size(); }
+  size_t pending_datagram_count() const { return neighbors_.pending_count(); }
 
 private:
   // Human-readable name of the interface
@@ -91,7 +130,16 @@ private:
 
   // The physical output port (+ a helper function `transmit` that uses it to send an Ethernet frame)
   std::shared_ptr<OutputPort> port_;
-  void transmit( const EthernetFrame& frame ) const { port_->transmit( *this, frame ); }
+  void transmit( EthernetFrame&& frame );
+
+  // While a burst is being processed, frames to send are collected here and handed to the port together at the end
+  bool batching_ {};
+  std::vector<EthernetFrame> transmit_batch_ {};
+  bool begin_batch() { return !std::exchange( batching_, true ); } // is this the outermost batch?
+  void end_batch();
+
+  template<typename T>
+  void send_to( T&& dgram, uint32_t next_hop );
 
   // Ethernet (known as hardware, network-access-layer, or link-layer) address of the interface
   EthernetAddress ethernet_address_;
@@ -102,37 +150,112 @@ private:
   // Datagrams that have been received
   std::queue<InternetDatagram> datagrams_received_ {};
 
-  constexpr static uint64_t ARP_INTERVAL_ = 5000;
-  constexpr static uint64_t ARP_TIMEOUT_ = 30000;
+  constexpr static std::chrono::microseconds ARP_INTERVAL_ = std::chrono::seconds { 5 };
+  constexpr static std::chrono::microseconds ARP_TIMEOUT_ = std::chrono::seconds { 30 };
+
+  // An unanswered request is resent from tick(), waiting twice as long each time, before giving up on the next hop
+  constexpr static unsigned MAX_ARP_RETRIES_ = 2;
+  static constexpr std::chrono::microseconds request_timeout( const NeighborTable::Neighbor& neighbor )
+  {
+    return ARP_INTERVAL_ * ( 1U << neighbor.retries );
+  }
+
+  // A mapping that is in use is refreshed shortly before it expires, with requests sent straight to the neighbor
+  // (at most one per ARP_PROBE_INTERVAL_), so that traffic to it keeps flowing while it's revalidated
+  constexpr static std::chrono::microseconds ARP_REFRESH_ = std::chrono::seconds { 3 };
+  constexpr static std::chrono::microseconds ARP_PROBE_INTERVAL_ = std::chrono::seconds { 1 };
 
   // current time
-  uint64_t cur_time_ {};
+  std::chrono::microseconds cur_time_ {};
+
+  // what the interface knows about each next hop: its mapping, outstanding request and queued datagrams
+  // (at most NeighborTable::MAX_NEIGHBORS next hops, NeighborTable::MAX_PENDING_PER_NEIGHBOR datagrams queued
+  // for one of them, and NeighborTable::MAX_PENDING in all)
+  NeighborTable neighbors_ {};
+  ARPStats arp_stats_ {};
+
+  // Timing wheel that ages out ARP state: every tracked next hop is listed once, in the slot for the earliest
+  // time its state could expire (modulo the wheel's span), and tick() visits the slots that time has reached
+  constexpr static std::chrono::microseconds WHEEL_SLOT_ = std::chrono::milliseconds { 100 };
+  constexpr static size_t WHEEL_SLOTS_ = 512;
+  static_assert( WHEEL_SLOT_ * WHEEL_SLOTS_ > ARP_TIMEOUT_
+                   and WHEEL_SLOT_ * WHEEL_SLOTS_ > ARP_INTERVAL_ * ( 1U << MAX_ARP_RETRIES_ ),
+                 "timing wheel too short" );
+
+  std::vector<std::vector<uint32_t>> wheel_ = std::vector<std::vector<uint32_t>>( WHEEL_SLOTS_ );
+  std::vector<uint32_t> wheel_due_ {};
+  uint64_t wheel_slot_ {}; // slots before this one have been visited in full
 
-  // map between mac address and ip address
-  std::unordered_map<uint32_t, MacAddrUnit> map_ip_ {};
+  // When does all of a next hop's ARP state expire?
+  static std::chrono::microseconds expiry( const NeighborTable::Neighbor& neighbor );
 
-  // map between ip address and ipv4 dgram queue
-  std::unordered_map<uint32_t, std::queue<InternetDatagram>> map_queue_ {};
+  // Start tracking a next hop (or return nullptr if the table is full)
+  NeighborTable::Neighbor* track( uint32_t ip_address );
+  void schedule( uint32_t ip_address, std::chrono::microseconds when );
+  void forget( NeighborTable::Neighbor& neighbor );
+  void age_neighbors();
 
-  // map between ip address and arp send time
-  std::unordered_map<uint32_t, uint64_t> map_send_time_ {};
+  void queue_datagram( NeighborTable::Neighbor& neighbor, const InternetDatagram& dgram );
+  void learn( uint32_t ip_address, const EthernetAddress& mac );
+  void send_arp_request( uint32_t ip_address, const EthernetAddress& dst );
 
-  template<isDgram T>
+  // (pass the datagram as an rvalue to move its payload into the frame instead of copying it)
+  template<typename T>
+  requires isDgram<std::remove_cvref_t<T>>
   static void datagramToEthernetFrame( EthernetFrame& ethernetFrame,
-                                       const T& internetDatagram,
+                                       T&& internetDatagram,
                                        const EthernetAddress& dst,
                                        const EthernetAddress& src,
                                        const uint64_t& type )
   {
     Serializer serializer;
-    internetDatagram.serialize( serializer );
+    std::forward<T>( internetDatagram ).serialize( serializer );
     // header
     auto& header = ethernetFrame.header;
     header.src = src;
     header.dst = dst;
     header.type = type;
     // frame
-    ethernetFrame.payload = serializer.output();
+    ethernetFrame.payload = serializer.finish();
+  }
+
+  // An IPv4 frame to a neighbor, under its prebuilt header. A datagram passed as an rvalue that still has the
+  // bytes it was received in (and no IP options), and whose payload is still the untouched rest of them, goes out
+  // in them, with just its header rewritten in place, unless something else holds on to them too.
+  template<typename T>
+  requires isDgram<std::remove_cvref_t<T>>
+  static void encapsulate( EthernetFrame& frame, T&& dgram, const EthernetHeader& header )
+  {
+    if constexpr ( std::is_same_v<T, InternetDatagram> ) {
+      if ( in_wire( dgram ) ) {
+        dgram.wire.remove_suffix( dgram.wire.size() - dgram.header.len ); // any Ethernet padding
+        dgram.payload.clear();                                             // (a slice of the same bytes)
+        if ( !dgram.wire.shared() ) {
+          dgram.header.encode( dgram.wire.mutable_data() );
+          frame.header = header;
+          frame.payload.clear();
+          frame.payload.push_back( std::move( dgram.wire ) );
+          return;
+        }
+        dgram.payload.push_back( dgram.wire.substr( IPv4Header::LENGTH ) );
+      }
+      dgram.wire = {};
+    }
+    datagramToEthernetFrame( frame, std::forward<T>( dgram ), header.dst, header.src, header.type );
+  }
+
+  // Can a datagram go out in the bytes it was received in? Its payload must be the slice of them that follows the
+  // header, either as received (with any padding) or up to the header's length, so that it hasn't been replaced,
+  // edited (which would have copied it) or cut short since.
+  static bool in_wire( const InternetDatagram& dgram )
+  {
+    const size_t len = dgram.header.len;
+    if ( dgram.header.hlen * 4 != IPv4Header::LENGTH || len < IPv4Header::LENGTH || dgram.wire.size() < len
+         || dgram.payload.size() != 1 || !dgram.payload.front().is_slice_of( dgram.wire, IPv4Header::LENGTH ) ) {
+      return false;
+    }
+    const size_t payload_size = dgram.payload.front().size();
+    return payload_size == len - IPv4Header::LENGTH || payload_size == dgram.wire.size() - IPv4Header::LENGTH;
   }
 
   static ARPMessage genArpEthernetFrame( uint16_t opcode,
@@ -154,15 +277,15 @@ private:
     return arpMessage;
   }
 
-  void transmitDgramInQueue( uint32_t sender_ip_address, const EthernetAddress& senderMac )
+  void transmitDgramInQueue( NeighborTable::Neighbor& neighbor )
   {
-    auto& senderQueue = map_queue_[sender_ip_address];
-    while ( !senderQueue.empty() ) {
-      auto& dgram = senderQueue.front();
-      EthernetFrame frame {};
-      datagramToEthernetFrame( frame, dgram, senderMac, ethernet_address_, EthernetHeader::TYPE_IPv4 );
-      transmit( frame );
-      senderQueue.pop();
+    // (frames are built before any is sent, since sending one may lead the port to call back into this interface)
+    std::vector<EthernetFrame> frames( neighbor.pending_count );
+    for ( auto& frame : frames ) {
+      encapsulate( frame, neighbors_.pop_pending( neighbor ), neighbor.header );
+    }
+    for ( auto& frame : frames ) {
+      transmit( std::move( frame ) );
     }
   }
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "route_table.hh"
+
+// The routes recently looked up in a RouteTable, one per destination address, in a small direct-mapped cache in
+// front of it (so the destinations that most traffic goes to skip the trie entirely). Entries are stamped with
+// the generation they were made in, and invalidate() starts a new one, so emptying the cache (as any change to
+// the table must, since it can change any route and move them all) takes no time.
+class RouteCache
+{
+public:
+  static constexpr size_t SIZE = 1024; // entries (16 KiB)
+
+  struct Stats
+  {
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  // Is the route for a destination cached? If so, it's put in `route` (nullptr if there is none).
+  bool find( const uint32_t address, const RouteTable::Route*& route )
+  {
+    const Entry& entry = entries_[slot( address )];
+    if ( entry.address == address && entry.generation == generation_ ) {
+      ++stats_.hits;
+      route = entry.route;
+      return true;
+    }
+    ++stats_.misses;
+    return false;
+  }
+
+  void insert( const uint32_t address, const RouteTable::Route* route )
+  {
+    entries_[slot( address )] = { address, generation_, route };
+  }
+
+  void invalidate()
+  {
+    if ( ++generation_ == 0 ) { // (after 2^32 of them, entries from long ago could match again)
+      entries_.fill( {} );
+      generation_ = 1;
+    }
+  }
+
+  const Stats& stats() const { return stats_; }
+
+private:
+  struct Entry
+  {
+    uint32_t address {};
+    uint32_t generation {}; // the cache's generations start at 1, so unused entries never match
+    const RouteTable::Route* route {};
+  };
+
+  std::array<Entry, SIZE> entries_ {};
+  uint32_t generation_ { 1 };
+  Stats stats_ {};
+
+  // Fibonacci hashing: the top bits of the address times 2^32 / phi
+  static size_t slot( const uint32_t address ) { return ( address * 0x9e3779b9U ) >> ( 32 - 10 ); }
+  static_assert( SIZE == 1 << 10 );
+};
@@ -0,0 +1,147 @@
+#include "route_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void RouteTable::add( const Route& route )
+{
+  if ( route.prefix_length > 32 ) {
+    throw runtime_error( "RouteTable: prefix length " + to_string( route.prefix_length ) + " is over 32" );
+  }
+  if ( route_count_ >= NODE - 1 ) {
+    throw runtime_error( "RouteTable: too many routes" );
+  }
+  if ( node_count_ == 0 ) {
+    for ( size_t n = 0; n < ROOT_NODES; ++n ) {
+      new_node( NO_ROUTE );
+    }
+  }
+
+  const uint8_t length = route.prefix_length;
+  const uint32_t prefix = length == 0 ? 0 : route.prefix & ~( ( uint64_t { 1 } << ( 32 - length ) ) - 1 );
+  if ( route_count_ % ROUTE_CHUNK_SIZE == 0 ) {
+    routes_.push_back( make_shared<RouteChunk>() );
+  } else if ( routes_.back().use_count() > 1 ) {
+    routes_.back() = make_shared<RouteChunk>( *routes_.back() );
+  }
+  Route& added = ( *routes_.back() )[route_count_ % ROUTE_CHUNK_SIZE];
+  added = route;
+  added.prefix = prefix;
+  const auto entry = static_cast<uint32_t>( ++route_count_ );
+
+  // the entries the prefix covers are all in one node (or the root), at the level its length ends in
+  const size_t i = prefix >> 16;
+  if ( length <= 16 ) {
+    paint( i, size_t { 1 } << ( 16 - length ), entry, length );
+    return;
+  }
+  if ( !( entry_at( i ) & NODE ) ) {
+    const uint32_t node = new_node( entry_at( i ) );
+    writable_entry( i ) = node;
+  }
+
+  const size_t j = node_base( entry_at( i ) ) + ( ( prefix >> 8 ) & 0xff );
+  if ( length <= 24 ) {
+    paint( j, size_t { 1 } << ( 24 - length ), entry, length );
+    return;
+  }
+  if ( !( entry_at( j ) & NODE ) ) {
+    const uint32_t node = new_node( entry_at( j ) );
+    writable_entry( j ) = node;
+  }
+
+  paint( node_base( entry_at( j ) ) + ( prefix & 0xff ), size_t { 1 } << ( 32 - length ), entry, length );
+}
+
+void RouteTable::lookup( const span<const uint32_t> addresses, const span<const Route*> routes ) const
+{
+  if ( routes.size() != addresses.size() ) {
+    throw runtime_error( "RouteTable: lookup of " + to_string( addresses.size() ) + " addresses into "
+                         + to_string( routes.size() ) + " results" );
+  }
+  if ( node_count_ == 0 ) {
+    ranges::fill( routes, nullptr );
+    return;
+  }
+
+  array<uint32_t, LOOKUP_GROUP> entries {};
+  array<size_t, LOOKUP_GROUP> next {}; // where each entry that is a node leads
+  for ( size_t first = 0; first < addresses.size(); first += LOOKUP_GROUP ) {
+    const auto group = addresses.subspan( first, min( LOOKUP_GROUP, addresses.size() - first ) );
+
+    for ( const uint32_t address : group ) {
+      __builtin_prefetch( &entry_at( address >> 16 ) );
+    }
+    for ( size_t i = 0; i < group.size(); ++i ) {
+      entries[i] = entry_at( group[i] >> 16 );
+      if ( entries[i] & NODE ) {
+        next[i] = node_base( entries[i] ) + ( ( group[i] >> 8 ) & 0xff );
+        __builtin_prefetch( &entry_at( next[i] ) );
+      }
+    }
+    for ( size_t i = 0; i < group.size(); ++i ) {
+      if ( entries[i] & NODE ) {
+        entries[i] = entry_at( next[i] );
+        if ( entries[i] & NODE ) {
+          next[i] = node_base( entries[i] ) + ( group[i] & 0xff );
+          __builtin_prefetch( &entry_at( next[i] ) );
+        }
+      }
+    }
+    for ( size_t i = 0; i < group.size(); ++i ) {
+      if ( entries[i] & NODE ) {
+        entries[i] = entry_at( next[i] );
+      }
+      routes[first + i] = entries[i] == NO_ROUTE ? nullptr : &route_at( entries[i] - 1 );
+      __builtin_prefetch( routes[first + i] ); // (for the caller)
+    }
+  }
+}
+
+uint32_t RouteTable::new_node( const uint32_t entry )
+{
+  const size_t number = node_count_;
+  if ( number >= NODE ) {
+    throw runtime_error( "RouteTable: too many nodes" );
+  }
+  const size_t first = number * NODE_SIZE;
+  if ( first % ENTRY_CHUNK_SIZE == 0 ) {
+    entries_.push_back( make_shared<EntryChunk>() );
+  }
+  auto& chunk = writable_chunk( first );
+  fill_n( chunk.begin() + first % ENTRY_CHUNK_SIZE, NODE_SIZE, entry );
+  ++node_count_;
+  return static_cast<uint32_t>( number ) | NODE;
+}
+
+RouteTable::EntryChunk& RouteTable::writable_chunk( const size_t i )
+{
+  auto& chunk = entries_[i / ENTRY_CHUNK_SIZE];
+  if ( chunk.use_count() > 1 ) {
+    chunk = make_shared<EntryChunk>( *chunk );
+  }
+  return *chunk;
+}
+
+void RouteTable::paint( const size_t first, const size_t count, const uint32_t entry, const uint8_t length )
+{
+  for ( size_t k = first; k < first + count; ++k ) {
+    const uint32_t current = entry_at( k );
+    if ( current & NODE ) {
+      paint( node_base( current ), NODE_SIZE, entry, length ); // (more specific routes below keep theirs)
+    } else if ( current == NO_ROUTE || route_at( current - 1 ).prefix_length <= length ) {
+      writable_entry( k ) = entry; // (so only the chunks whose entries change are copied)
+    }
+  }
+}
+
+size_t RouteTable::memory_footprint() const
+{
+  return entries_.size() * sizeof( EntryChunk ) + routes_.size() * sizeof( RouteChunk )
+         + ( entries_.capacity() + routes_.capacity() ) * sizeof( shared_ptr<EntryChunk> );
+}
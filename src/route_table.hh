@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// A Router's forwarding rules, looked up by longest prefix match in a multibit trie with strides of 16, 8 and 8
+// bits ("DIR-16-8-8"). The first 16 bits of an address index a root array; an entry there is either the route
+// for the whole /16 (already resolved to the longest matching prefix, or none), or the index of a 256-entry node
+// for the next 8 bits, whose entries are resolved in turn or point to a node for the last 8. So a lookup reads
+// at most three entries, and the routes themselves are kept in a separate array.
+//
+// Of two routes with the same prefix length that both match, the one added last wins.
+//
+// The entries and the routes are stored in fixed-size chunks, which copies of a table share until one of them
+// changes: a change to a copy first copies just the chunks it writes to, so a slightly different version of even
+// a large table is cheap to make (as a Fib does for every update), and the version it was made from stays as it
+// was, down to the addresses of its routes.
+class RouteTable
+{
+public:
+  struct Route
+  {
+    uint32_t prefix {};       // with any bits past `prefix_length` cleared
+    uint8_t prefix_length {}; // (at most 32)
+    bool direct {};           // the network is attached: the next hop is the datagram's destination
+    uint32_t next_hop {};     // (unless `direct`)
+    size_t interface_num {};
+  };
+
+  // Throws if the prefix length is over 32
+  void add( const Route& route );
+
+  // The longest matching prefix's route, if any
+  const Route* lookup( uint32_t address ) const
+  {
+    if ( node_count_ == 0 ) {
+      return nullptr;
+    }
+    uint32_t entry = entry_at( address >> 16 );
+    if ( entry & NODE ) {
+      entry = entry_at( node_base( entry ) + ( ( address >> 8 ) & 0xff ) );
+      if ( entry & NODE ) {
+        entry = entry_at( node_base( entry ) + ( address & 0xff ) );
+      }
+    }
+    return entry == NO_ROUTE ? nullptr : &route_at( entry - 1 );
+  }
+
+  // The same for each of a batch of addresses (into `routes`, which must be as long). Lookups are done in
+  // interleaved groups of LOOKUP_GROUP: each level's entries are prefetched for the whole group before any of them
+  // is read, so the cache misses of a group overlap instead of following one another.
+  static constexpr size_t LOOKUP_GROUP = 16;
+  void lookup( std::span<const uint32_t> addresses, std::span<const Route*> routes ) const;
+
+  size_t size() const { return route_count_; }
+
+  // Bytes allocated for the trie and the routes (including what is shared with copies of the table)
+  size_t memory_footprint() const;
+
+private:
+  // An entry is NO_ROUTE, a route (its index among the routes, plus one), or a node (its number, with NODE set)
+  static constexpr uint32_t NO_ROUTE = 0;
+  static constexpr uint32_t NODE = 0x80000000;
+  static constexpr size_t NODE_SIZE = 256;
+  static constexpr size_t ROOT_NODES = 256; // the root's 65536 entries are the first 256 nodes' worth
+
+  static constexpr size_t ENTRY_CHUNK_SIZE = 64 * NODE_SIZE; // (64 KiB)
+  static constexpr size_t ROUTE_CHUNK_SIZE = 1024;           // (24 KiB)
+  using EntryChunk = std::array<uint32_t, ENTRY_CHUNK_SIZE>;
+  using RouteChunk = std::array<Route, ROUTE_CHUNK_SIZE>;
+
+  std::vector<std::shared_ptr<EntryChunk>> entries_ {}; // the root, then the nodes, once there are any routes
+  std::vector<std::shared_ptr<RouteChunk>> routes_ {};
+  size_t node_count_ {};
+  size_t route_count_ {};
+
+  const uint32_t& entry_at( const size_t i ) const
+  {
+    return ( *entries_[i / ENTRY_CHUNK_SIZE] )[i % ENTRY_CHUNK_SIZE];
+  }
+  const Route& route_at( const size_t i ) const
+  {
+    return ( *routes_[i / ROUTE_CHUNK_SIZE] )[i % ROUTE_CHUNK_SIZE];
+  }
+
+  // The chunk holding entry `i`, copied first if it's shared
+  EntryChunk& writable_chunk( size_t i );
+  uint32_t& writable_entry( const size_t i ) { return writable_chunk( i )[i % ENTRY_CHUNK_SIZE]; }
+
+  static size_t node_base( uint32_t entry ) { return size_t { entry & ~NODE } * NODE_SIZE; }
+
+  // A new node whose entries all resolve the way `entry` (a route, or NO_ROUTE) did, as an entry pointing to it
+  uint32_t new_node( uint32_t entry );
+
+  // Give `entry` (a route of the prefix length `length`) to every address in `count` entries from `first`, where
+  // it is at least as long as what they match now
+  void paint( size_t first, size_t count, uint32_t entry, uint8_t length );
+};
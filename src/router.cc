@@ -20,54 +20,99 @@ void Router::add_route( const uint32_t route_prefix,
        << static_cast<int>( prefix_length ) << " => " << ( next_hop.has_value() ? next_hop->ip() : "(direct)" )
        << " on interface " << interface_num << "\n";
 
-  router_table_.emplace_back( route_prefix, prefix_length, next_hop, interface_num );
+  const RouteTable::Route route { .prefix = route_prefix,
+                                  .prefix_length = prefix_length,
+                                  .direct = !next_hop.has_value(),
+                                  .next_hop = next_hop.has_value() ? next_hop->ipv4_numeric() : 0,
+                                  .interface_num = interface_num };
+  add_routes( { &route, 1 } );
+}
+
+void Router::add_routes( const span<const RouteTable::Route> routes )
+{
+  fib_.update( [&]( RouteTable& table ) {
+    for ( const auto& route : routes ) {
+      table.add( route );
+    }
+  } );
 }
 
 // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
 void Router::route()
 {
+  // (offline again at the end, and the cached routes may be reclaimed with their version)
+  const Fib::Reader::Section online { fib_reader_ };
+  outbound_.resize( _interfaces.size() );
   for ( auto& item : _interfaces ) {
     auto& dgram_queue = item->datagrams_received();
     while ( !dgram_queue.empty() ) {
-      auto& dgram = dgram_queue.front();
-      // check TTL
-      int ttl = static_cast<int>( dgram.header.ttl );
-      dgram.header.ttl = static_cast<uint8_t>( max( ttl - 1, 0 ) );
-      dgram.header.compute_checksum();
-      // if TTL>0, route
-      if ( dgram.header.ttl != 0 ) {
-        routeHelperFunc( dgram );
+      while ( !dgram_queue.empty() && burst_.size() < ROUTE_BURST ) {
+        auto& dgram = dgram_queue.front();
+        // check TTL
+        dgram.header.decrement_ttl();
+        // if TTL>0, route
+        if ( dgram.header.ttl != 0 ) {
+          burst_.push_back( std::move( dgram ) );
+        }
+        dgram_queue.pop();
       }
-      dgram_queue.pop();
+      routeHelperFunc();
+    }
+  }
+  // send each interface its datagrams in one batch
+  for ( size_t i = 0; i < _interfaces.size(); ++i ) {
+    if ( !outbound_[i].empty() ) {
+      _interfaces[i]->send_datagrams( outbound_[i] );
+      outbound_[i].clear();
     }
   }
 }
 
-void Router::routeHelperFunc( const InternetDatagram& dgram )
+void Router::routeHelperFunc()
 {
-  // find proper interface
-  uint32_t ip_numeric = dgram.header.dst;
-  size_t route_interface = _interfaces.size();
-  uint8_t max_prefix = 0;
-  std::optional<Address> next_hop;
-  for ( auto& item : router_table_ ) {
-    uint8_t cur_prefix_len = item.prefix_length_;
-    uint32_t ip_comp = cur_prefix_len > 0 ? ip_numeric >> ( 32 - cur_prefix_len ) : 0;
-    uint32_t prefix_comp = cur_prefix_len > 0 ? item.route_prefix_ >> ( 32 - cur_prefix_len ) : 0;
-    if ( ip_comp == prefix_comp ) {
-      if ( cur_prefix_len >= max_prefix ) {
-        route_interface = item.interface_num_;
-        max_prefix = cur_prefix_len;
-        next_hop = item.next_hop_;
-      }
+  // find proper interfaces: by longest prefix match, for the whole burst at once (or for its misses in the cache)
+  const Fib::Version& fib = fib_reader_.current();
+  burst_dst_.clear();
+  for ( const auto& dgram : burst_ ) {
+    burst_dst_.push_back( dgram.header.dst );
+  }
+  burst_routes_.resize( burst_dst_.size() );
+  if ( cache_routes_ ) {
+    lookupCached( fib );
+  } else {
+    fib.table.lookup( burst_dst_, burst_routes_ );
+  }
+
+  for ( size_t i = 0; i < burst_.size(); ++i ) {
+    const auto* rule = burst_routes_[i];
+    if ( rule && rule->interface_num < _interfaces.size() ) {
+      outbound_[rule->interface_num].push_back(
+        { std::move( burst_[i] ), rule->direct ? burst_dst_[i] : rule->next_hop } );
+    }
+  }
+  burst_.clear();
+}
+
+void Router::lookupCached( const Fib::Version& fib )
+{
+  if ( fib.number != cached_version_ ) {
+    route_cache_.invalidate();
+    cached_version_ = fib.number;
+  }
+  miss_dst_.clear();
+  miss_index_.clear();
+  for ( size_t i = 0; i < burst_dst_.size(); ++i ) {
+    if ( !route_cache_.find( burst_dst_[i], burst_routes_[i] ) ) {
+      miss_dst_.push_back( burst_dst_[i] );
+      miss_index_.push_back( i );
     }
   }
-  if ( route_interface < _interfaces.size() ) {
-    auto& interface = _interfaces[route_interface];
-    if ( next_hop.has_value() ) {
-      interface->send_datagram( dgram, next_hop.value() );
-    } else {
-      interface->send_datagram( dgram, Address::from_ipv4_numeric( ip_numeric ) );
+  if ( !miss_dst_.empty() ) {
+    miss_routes_.resize( miss_dst_.size() );
+    fib.table.lookup( miss_dst_, miss_routes_ );
+    for ( size_t j = 0; j < miss_dst_.size(); ++j ) {
+      burst_routes_[miss_index_[j]] = miss_routes_[j];
+      route_cache_.insert( miss_dst_[j], miss_routes_[j] );
     }
   }
 }
@@ -2,15 +2,26 @@
 
 #include <memory>
 #include <optional>
+#include <span>
 
 #include "exception.hh"
+#include "fib.hh"
 #include "network_interface.hh"
+#include "route_cache.hh"
+#include "route_table.hh"
 
 // \brief A router that has multiple network interfaces and
 // performs longest-prefix-match routing between them.
 class Router
 {
 public:
+  Router() = default;
+
+  // With `cache_routes`, route() looks for each destination's route in a RouteCache before looking it up in the
+  // table. That pays off only when most traffic goes to few enough destinations that their routes stay cached
+  // (see route_speed_test); otherwise the batched lookups in the table alone are faster.
+  explicit Router( bool cache_routes ) : cache_routes_( cache_routes ) {}
+
   // Add an interface to the router
   // \param[in] interface an already-constructed network interface
   // \returns The index of the interface after it has been added to the router
@@ -23,30 +34,53 @@ public:
   // Access an interface by index
   std::shared_ptr<NetworkInterface> interface( const size_t N ) { return _interfaces.at( N ); }
 
-  // Add a route (a forwarding rule)
+  // Add a route (a forwarding rule). Unlike the rest of the Router, this may be called from another thread while
+  // route() runs.
   void add_route( uint32_t route_prefix,
                   uint8_t prefix_length,
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
+  // Add many routes at once, in one new version of the table (each version costs a copy of the parts of the table
+  // it changes, so a batch of routes costs much less than adding them one at a time)
+  void add_routes( std::span<const RouteTable::Route> routes );
+
   // Route packets between the interfaces
   void route();
 
-  struct rule
-  {
-    uint32_t route_prefix_;
-    uint8_t prefix_length_;
-    std::optional<Address> next_hop_;
-    size_t interface_num_;
-  };
+  // The router table (which may likewise be updated from other threads, many routes at a time)
+  Fib& fib() { return fib_; }
+
+  // How often route() found a datagram's route in the cache, or had to look it up in the table (if it uses one)
+  const RouteCache::Stats& route_cache_stats() const { return route_cache_.stats(); }
 
 private:
   // The router's collection of network interfaces
   std::vector<std::shared_ptr<NetworkInterface>> _interfaces {};
 
-  // the router table
-  std::vector<rule> router_table_ {};
+  // the router table, and (if `cache_routes_`) the routes most recently looked up in it, in the version
+  // `cached_version_`
+  Fib fib_ {};
+  Fib::Reader fib_reader_ { fib_.reader() };
+  bool cache_routes_ {};
+  RouteCache route_cache_ {};
+  uint64_t cached_version_ {};
+
+  // datagrams routed to each interface, sent as one batch at the end of route()
+  std::vector<std::vector<NetworkInterface::OutboundDatagram>> outbound_ {};
+
+  // a burst of datagrams drained from an interface, whose routes are looked up together
+  static constexpr size_t ROUTE_BURST = 64;
+  std::vector<InternetDatagram> burst_ {};
+  std::vector<uint32_t> burst_dst_ {};
+  std::vector<const RouteTable::Route*> burst_routes_ {};
+  std::vector<uint32_t> miss_dst_ {};    // the destinations in the burst that weren't in the cache
+  std::vector<size_t> miss_index_ {};    // (where they are in the burst)
+  std::vector<const RouteTable::Route*> miss_routes_ {};
+
+  // route helper func (for the datagrams in `burst_`)
+  void routeHelperFunc();
 
-  // route helper func
-  void routeHelperFunc( const InternetDatagram& dgram );
+  // find the routes for the destinations in `burst_dst_` through the route cache, looking up its misses together
+  void lookupCached( const Fib::Version& fib );
 };
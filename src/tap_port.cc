@@ -0,0 +1,56 @@
+#include "tap_port.hh"
+
+#include <utility>
+
+using namespace std;
+
+TapPort::TapPort( TapFD&& tap ) : tap_( std::move( tap ) )
+{
+  tap_.set_blocking( false );
+}
+
+void TapPort::transmit( const NetworkInterface& sender [[maybe_unused]], const EthernetFrame& frame )
+{
+  tap_.write( serialize( frame ) );
+  ++stats_.frames_sent;
+}
+
+size_t TapPort::receive( NetworkInterface& interface )
+{
+  burst_.clear();
+  while ( burst_.size() < MAX_BURST ) {
+    if ( pool_.empty() ) {
+      pool_.emplace_back( MAX_FRAME_SIZE, 0 );
+    }
+    string& buffer = pool_.back();
+    tap_.read( buffer );
+    ++stats_.reads;
+    if ( buffer.empty() ) { // nothing more to read
+      buffer.resize( MAX_FRAME_SIZE );
+      break;
+    }
+
+    // the payload is a slice of the buffer, which the frame now owns
+    EthernetFrame frame;
+    if ( not parse( frame, vector<Buffer> { exchange( buffer, {} ) } ) ) {
+      ++stats_.bad_frames;
+      pool_.back().resize( MAX_FRAME_SIZE );
+      continue;
+    }
+    pool_.pop_back();
+    burst_.push_back( std::move( frame ) );
+  }
+
+  if ( burst_.empty() ) {
+    return 0;
+  }
+  stats_.frames_received += burst_.size();
+  ++stats_.bursts;
+  interface.recv_frames( burst_ );
+
+  // top the pool up for the next burst, now that this one has been handled
+  while ( pool_.size() < MAX_BURST ) {
+    pool_.emplace_back( MAX_FRAME_SIZE, 0 );
+  }
+  return burst_.size();
+}
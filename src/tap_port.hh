@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ethernet_frame.hh"
+#include "ethernet_header.hh"
+#include "network_interface.hh"
+#include "tun.hh"
+
+// Connects a NetworkInterface to a Linux TAP device, which carries whole Ethernet frames: as its OutputPort, it
+// writes the interface's frames to the device, and receive() reads the frames waiting on the device, as many as
+// are there (up to MAX_BURST) per wakeup, and hands them to the interface as one batch.
+//
+// Each frame is read straight into a buffer of its own, which becomes the frame's payload without being copied
+// (so a router can forward the datagram in it in place). Buffers are allocated ahead of time, in a pool that is
+// topped up between bursts, and a buffer that a read comes up empty in goes back to the pool.
+class TapPort : public NetworkInterface::OutputPort
+{
+public:
+  static constexpr size_t MAX_FRAME_SIZE = EthernetHeader::LENGTH + 1500; // the device's MTU must be 1500 or less
+  static constexpr size_t MAX_BURST = 64;
+
+  // Takes over the device, and makes it non-blocking
+  explicit TapPort( TapFD&& tap );
+
+  void transmit( const NetworkInterface& sender, const EthernetFrame& frame ) override;
+
+  // Read the frames waiting on the device into `interface`. Returns how many there were.
+  size_t receive( NetworkInterface& interface );
+
+  // The device (e.g. to wait for it to be readable)
+  TapFD& fd() { return tap_; }
+
+  struct Stats
+  {
+    uint64_t frames_received;
+    uint64_t frames_sent;
+    uint64_t reads;
+    uint64_t bursts; // calls to receive() that got at least one frame
+    uint64_t bad_frames;
+  };
+  const Stats& stats() const { return stats_; }
+
+private:
+  TapFD tap_;
+  std::vector<std::string> pool_ {}; // read buffers, each MAX_FRAME_SIZE long
+  std::vector<EthernetFrame> burst_ {};
+  Stats stats_ {};
+};
@@ -1,5 +1,8 @@
 #include "tcp_minnow_socket_impl.hh"
 
-//! Specializations of TCPMinnowSocket for TCPOverIPv4OverTunFdAdapter and its lossy version
+//! Specializations of TCPMinnowSocket for TCPOverIPv4OverTunFdAdapter, its lossy and emulated-path versions,
+//! and LoopbackAdapter
 template class TCPMinnowSocket<TCPOverIPv4OverTunFdAdapter>;
 template class TCPMinnowSocket<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+template class TCPMinnowSocket<NetemFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+template class TCPMinnowSocket<LoopbackAdapter>;
@@ -14,7 +14,8 @@ void TCPReceiver::receive( TCPSenderMessage message )
   }
   if ( has_ISN_ ) {
     auto checkpoint = writer().bytes_pushed() + 1;
-    reassembler_.insert( seq.unwrap( ISN_, checkpoint ) - 1 + offset, message.payload, message.FIN || message.RST );
+    reassembler_.insert(
+      seq.unwrap( ISN_, checkpoint ) - 1 + offset, std::move( message.payload ).release(), message.FIN || message.RST );
   }
   ackno_ = has_ISN_ + writer().bytes_pushed() + writer().is_closed();
   if ( message.RST ) {
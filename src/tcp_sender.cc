@@ -24,7 +24,7 @@ void TCPSender::push( const TransmitFunction& transmit )
     uint64_t trans_len
       = min( min( TCPConfig::MAX_PAYLOAD_SIZE, peer_win_size_ - sequence_numbers_in_flight() - !has_isn_ ),
              reader().bytes_buffered() );
-    string payload {};
+    Buffer payload {};
     uint64_t index = reader().bytes_popped();
     // if not sent syn, sent
     // if sent syn, when buffer is not empty, sent
@@ -32,7 +32,7 @@ void TCPSender::push( const TransmitFunction& transmit )
       read( input_.reader(), trans_len, payload );
       TCPSenderMessage msg = { .seqno = Wrap32::wrap( index + has_isn_, isn_ ),
                                .SYN = !has_isn_,
-                               .payload = payload,
+                               .payload = std::move( payload ),
                                .FIN = getCanSentFin(),
                                .RST = reader().has_error() };
       if ( !has_isn_ ) {
@@ -42,7 +42,7 @@ void TCPSender::push( const TransmitFunction& transmit )
         has_fin_ = true;
       }
       // save copy
-      retransmissionTimer_.insertAcknoList( msg, cur_ms_ );
+      retransmissionTimer_.insertAcknoList( msg, cur_time_ );
       transmit( msg );
     }
   }
@@ -75,8 +75,8 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
       auto flag = retransmissionTimer_.updateAcknoList(
         msg.ackno->unwrap( isn_, reader().bytes_popped() + has_isn_ ), isn_, reader().bytes_popped() + has_isn_ );
       if ( flag ) {
-        retransmissionTimer_.resetRTOms( initial_RTO_ms_ );
-        retransmissionTimer_.resetTimer( cur_ms_ );
+        retransmissionTimer_.resetRTO( initial_RTO_ );
+        retransmissionTimer_.resetTimer( cur_time_ );
         retransmissionTimer_.resetConsecutiveRetransmissions();
       }
       largest_ackno = max( largest_ackno, msg.ackno->unwrap( isn_, reader().bytes_popped() + has_isn_ ) );
@@ -87,22 +87,28 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
   }
 }
 
-void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
+void TCPSender::tick( chrono::microseconds time_since_last_tick, const TransmitFunction& transmit )
 {
-  cur_ms_ += ms_since_last_tick;
-  retransmissionTimer_.updateRetransmissionTimer( cur_ms_, transmit );
+  cur_time_ += time_since_last_tick;
+  retransmissionTimer_.updateRetransmissionTimer( cur_time_, transmit );
 }
 
-void TCPSender::RetransmissionTimer::updateRetransmissionTimer( uint64_t cur_ms, const TransmitFunction& transmit )
+optional<chrono::microseconds> TCPSender::next_timeout() const
+{
+  return retransmissionTimer_.getTimeUntilExpiry( cur_time_ );
+}
+
+void TCPSender::RetransmissionTimer::updateRetransmissionTimer( chrono::microseconds cur_time,
+                                                                const TransmitFunction& transmit )
 {
   auto it = expected_ackno_list_.begin();
   for ( ; it != expected_ackno_list_.end(); ++it ) {
-    if ( cur_ms - it->start_ms_ >= cur_RTO_ms_ ) {
+    if ( cur_time - it->start_time_ >= cur_RTO_ ) {
       transmit( it->mes_ );
-      it->start_ms_ = cur_ms;
+      it->start_time_ = cur_time;
       if ( win_nonzero_ ) {
         consecutive_retransmissions_++;
-        cur_RTO_ms_ *= 2;
+        cur_RTO_ *= 2;
       }
     }
     break;
@@ -150,7 +156,7 @@ bool TCPSender::RetransmissionTimer::updateAcknoList( uint64_t ackno, Wrap32& is
   }
   return has_remove_outstanding;
 }
-void TCPSender::RetransmissionTimer::insertAcknoList( TCPSenderMessage msg_, uint64_t start_ms_ )
+void TCPSender::RetransmissionTimer::insertAcknoList( TCPSenderMessage msg_, chrono::microseconds start_time )
 {
-  expected_ackno_list_.emplace_back( msg_, start_ms_ );
+  expected_ackno_list_.emplace_back( msg_, start_time );
 }
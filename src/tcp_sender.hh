@@ -4,6 +4,7 @@
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <list>
@@ -15,8 +16,13 @@ class TCPSender
 {
 public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
+  TCPSender( ByteStream&& input, Wrap32 isn, std::chrono::microseconds initial_RTO )
+    : input_( std::move( input ) ), isn_( isn ), initial_RTO_( initial_RTO )
+  {}
+
+  /* Construct TCP sender with a default Retransmission Timeout given in whole milliseconds */
   TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms )
-    : input_( std::move( input ) ), isn_( isn ), initial_RTO_ms_( initial_RTO_ms )
+    : TCPSender( std::move( input ), isn, std::chrono::milliseconds { initial_RTO_ms } )
   {}
 
   /* Generate an empty TCPSenderMessage */
@@ -31,8 +37,17 @@ public:
   /* Push bytes from the outbound stream */
   void push( const TransmitFunction& transmit );
 
+  /* Time has passed by the given duration since the last time the tick() method was called */
+  void tick( std::chrono::microseconds time_since_last_tick, const TransmitFunction& transmit );
+
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called */
-  void tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit );
+  void tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
+  {
+    tick( std::chrono::milliseconds { ms_since_last_tick }, transmit );
+  }
+
+  /* How long until tick() would retransmit? (empty if the retransmission timer isn't running) */
+  std::optional<std::chrono::microseconds> next_timeout() const;
 
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
@@ -47,15 +62,16 @@ public:
   class RetransmissionTimer
   {
   public:
-    RetransmissionTimer( uint64_t initial_RTO_ms ) : cur_RTO_ms_( initial_RTO_ms ), expected_ackno_list_( {} ) {}
+    RetransmissionTimer( std::chrono::microseconds initial_RTO ) : cur_RTO_( initial_RTO ), expected_ackno_list_( {} )
+    {}
     struct AckWrapper
     {
       TCPSenderMessage mes_;
-      uint64_t start_ms_;
+      std::chrono::microseconds start_time_;
     };
-    void updateRetransmissionTimer( uint64_t cur_ms, const TransmitFunction& transmit );
+    void updateRetransmissionTimer( std::chrono::microseconds cur_time, const TransmitFunction& transmit );
     bool updateAcknoList( uint64_t ackno, Wrap32& isn, uint64_t checkpoint );
-    void insertAcknoList( TCPSenderMessage msg_, uint64_t start_ms_ );
+    void insertAcknoList( TCPSenderMessage msg_, std::chrono::microseconds start_time );
     void updateWinNonZero( uint64_t peer_win_size ) { win_nonzero_ = ( peer_win_size != 0 ); }
     uint64_t getConsecutiveRetransmissions() const { return consecutive_retransmissions_; }
     uint64_t getSequenceNumbersInFlight() const
@@ -66,17 +82,25 @@ public:
       }
       return sum;
     }
+    std::optional<std::chrono::microseconds> getTimeUntilExpiry( std::chrono::microseconds cur_time ) const
+    {
+      if ( expected_ackno_list_.empty() ) {
+        return {};
+      }
+      const auto elapsed = cur_time - expected_ackno_list_.front().start_time_;
+      return elapsed >= cur_RTO_ ? std::chrono::microseconds::zero() : cur_RTO_ - elapsed;
+    }
     void resetConsecutiveRetransmissions() { consecutive_retransmissions_ = 0; }
-    void resetRTOms( uint64_t initial_RTO_ms ) { cur_RTO_ms_ = initial_RTO_ms; }
-    void resetTimer( uint64_t cur_ms )
+    void resetRTO( std::chrono::microseconds initial_RTO ) { cur_RTO_ = initial_RTO; }
+    void resetTimer( std::chrono::microseconds cur_time )
     {
       for ( auto& i : expected_ackno_list_ ) {
-        i.start_ms_ = cur_ms;
+        i.start_time_ = cur_time;
       }
     }
 
   private:
-    uint64_t cur_RTO_ms_ {};
+    std::chrono::microseconds cur_RTO_ {};
     uint64_t consecutive_retransmissions_ {};
     std::list<AckWrapper> expected_ackno_list_;
     bool win_nonzero_ { true };
@@ -86,17 +110,17 @@ private:
   // Variables initialized in constructor
   ByteStream input_;
   Wrap32 isn_;
-  uint64_t initial_RTO_ms_;
+  std::chrono::microseconds initial_RTO_;
 
   // Variables used
-  uint64_t cur_ms_ {};
+  std::chrono::microseconds cur_time_ {};
   uint64_t peer_win_size_ { 1 };
   uint64_t largest_ackno { 0 };
   bool has_isn_ { false };
   bool has_fin_ { false };
 
   // Retransmission Timer
-  RetransmissionTimer retransmissionTimer_ { initial_RTO_ms_ };
+  RetransmissionTimer retransmissionTimer_ { initial_RTO_ };
 
   // save transmit function for close
   TransmitFunction saveTransFunc_ {};
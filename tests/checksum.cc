@@ -0,0 +1,154 @@
+#include "checksum.hh"
+#include "common.hh"
+#include "ipv4_header.hh"
+#include "random.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr array kernels { ChecksumKernel::Scalar, ChecksumKernel::SSE2, ChecksumKernel::AVX2 };
+
+// The original byte-at-a-time algorithm, as a reference
+uint16_t reference_checksum( const vector<string_view>& chunks )
+{
+  uint32_t sum = 0;
+  bool parity = false;
+  for ( const auto chunk : chunks ) {
+    for ( const uint8_t i : chunk ) {
+      sum += parity ? i : i << 8;
+      parity = !parity;
+    }
+  }
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + static_cast<uint16_t>( sum );
+  }
+  return ~sum;
+}
+
+// 0x0000 and 0xffff are both zero in one's complement
+bool same_checksum( const uint16_t actual, const uint16_t expected )
+{
+  return actual == expected or ( actual == 0 and expected == 0xffff ) or ( actual == 0xffff and expected == 0 );
+}
+
+// Every kernel available on this CPU, and the dispatching versions, agree with the reference on `data`, both
+// summing it in place and copying it to a destination at a different alignment
+void check_kernels( const string_view data, const size_t offset )
+{
+  const uint16_t expected = reference_checksum( { data } );
+  const string where = " on " + to_string( data.size() ) + " bytes at offset " + to_string( offset );
+
+  string copy( data.size() + 1, 0 );
+  for ( const auto kernel : kernels ) {
+    if ( checksum_kernel_supported( kernel ) ) {
+      const string name { checksum_kernel_name( kernel ) };
+      expect( same_checksum( ~internet_checksum_partial( data, kernel ), expected ),
+              "checksum mismatch for the " + name + " kernel" + where );
+
+      copy.assign( copy.size(), 0 );
+      expect( same_checksum( ~internet_checksum_copy( copy.data() + 1, data, kernel ), expected ),
+              "checksum-and-copy mismatch for the " + name + " kernel" + where );
+      expect( string_view { copy }.substr( 1 ) == data, "the " + name + " kernel copied the wrong bytes" + where );
+    }
+  }
+
+  expect( same_checksum( ~internet_checksum_partial( data ), expected ), "dispatched checksum mismatch" + where );
+  copy.assign( copy.size(), 0 );
+  expect( same_checksum( ~internet_checksum_copy( copy.data() + 1, data ), expected )
+            and string_view { copy }.substr( 1 ) == data,
+          "dispatched checksum-and-copy mismatch" + where );
+}
+
+// InternetChecksum gives the same result however the data is split into chunks, including at odd boundaries
+void check_chunks( const string_view data, default_random_engine& rd )
+{
+  vector<string_view> chunks;
+  string_view rest = data;
+  while ( not rest.empty() ) {
+    const size_t chunk_len = uniform_int_distribution<size_t> { 0, rest.size() }( rd );
+    chunks.push_back( rest.substr( 0, chunk_len ) );
+    rest.remove_prefix( chunk_len );
+  }
+
+  InternetChecksum check;
+  check.add( chunks );
+  expect( check.value() == reference_checksum( chunks ),
+          "InternetChecksum mismatch on " + to_string( data.size() ) + " bytes in " + to_string( chunks.size() )
+            + " chunks" );
+}
+
+void check_checksums( default_random_engine& rd )
+{
+  uniform_int_distribution<char> byte_dist;
+  string buffer( 4096, 0 );
+  for ( auto& ch : buffer ) {
+    ch = byte_dist( rd );
+  }
+
+  // every length up to a few vectors' worth (where the kernels' tails and the dispatch threshold are), at every
+  // alignment within a cache line
+  for ( size_t offset = 0; offset < 64; ++offset ) {
+    for ( size_t len = 0; len <= 200; ++len ) {
+      check_kernels( string_view { buffer }.substr( offset, len ), offset );
+    }
+  }
+
+  // and longer ones, at random
+  for ( int trial = 0; trial < 2000; ++trial ) {
+    const size_t offset = uniform_int_distribution<size_t> { 0, 63 }( rd );
+    const size_t len = uniform_int_distribution<size_t> { 0, 4000 }( rd );
+    const string_view data = string_view { buffer }.substr( offset, len );
+    check_kernels( data, offset );
+    check_chunks( data, rd );
+  }
+}
+
+// Decrementing the TTL with an incremental update (RFC 1624) gives the same checksum as recomputing it
+void check_ttl_decrement( default_random_engine& rd )
+{
+  for ( int trial = 0; trial < 100; ++trial ) {
+    IPv4Header header;
+    header.tos = uniform_int_distribution<uint8_t> {}( rd );
+    header.len = uniform_int_distribution<uint16_t> { IPv4Header::LENGTH, UINT16_MAX }( rd );
+    header.id = uniform_int_distribution<uint16_t> {}( rd );
+    header.ttl = uniform_int_distribution<uint8_t> { 1, UINT8_MAX }( rd );
+    header.proto = uniform_int_distribution<uint8_t> {}( rd );
+    header.src = uniform_int_distribution<uint32_t> {}( rd );
+    header.dst = uniform_int_distribution<uint32_t> {}( rd );
+    header.compute_checksum();
+
+    while ( header.ttl > 0 ) {
+      header.decrement_ttl();
+      IPv4Header recomputed = header;
+      recomputed.compute_checksum();
+      expect( header.cksum == recomputed.cksum,
+              "incremental checksum update disagrees with recomputation: " + header.to_string() );
+    }
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    check_checksums( rd );
+    check_ttl_decrement( rd );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
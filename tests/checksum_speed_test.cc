@@ -0,0 +1,192 @@
+#include "checksum.hh"
+#include "ipv4_header.hh"
+#include "random.hh"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr array kernels { ChecksumKernel::Scalar, ChecksumKernel::SSE2, ChecksumKernel::AVX2 };
+
+// The original byte-at-a-time algorithm, as a baseline
+uint16_t reference_checksum( const vector<string_view>& chunks )
+{
+  uint32_t sum = 0;
+  bool parity = false;
+  for ( const auto chunk : chunks ) {
+    for ( const uint8_t i : chunk ) {
+      sum += parity ? i : i << 8;
+      parity = !parity;
+    }
+  }
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + static_cast<uint16_t>( sum );
+  }
+  return ~sum;
+}
+
+// Compare the costs of decrementing the TTL by recomputing the checksum and by updating it incrementally
+// (RFC 1624; tests/checksum.cc checks that they agree)
+void ttl_test( default_random_engine& rd )
+{
+  vector<IPv4Header> headers( 1024 );
+  for ( auto& header : headers ) {
+    header.tos = uniform_int_distribution<uint8_t> {}( rd );
+    header.len = uniform_int_distribution<uint16_t> { IPv4Header::LENGTH, UINT16_MAX }( rd );
+    header.id = uniform_int_distribution<uint16_t> {}( rd );
+    header.ttl = uniform_int_distribution<uint8_t> { 1, UINT8_MAX }( rd );
+    header.proto = uniform_int_distribution<uint8_t> {}( rd );
+    header.src = uniform_int_distribution<uint32_t> {}( rd );
+    header.dst = uniform_int_distribution<uint32_t> {}( rd );
+    header.compute_checksum();
+  }
+
+  const auto time_per_header = [&]( const auto& decrement ) {
+    constexpr size_t rounds = 1000;
+    const auto start_time = steady_clock::now();
+    for ( size_t i = 0; i < rounds; ++i ) {
+      for ( auto& header : headers ) {
+        header.ttl |= 1; // never reaches zero
+        decrement( header );
+      }
+    }
+    const auto elapsed = duration_cast<duration<double, nano>>( steady_clock::now() - start_time );
+    return elapsed.count() / static_cast<double>( rounds * headers.size() );
+  };
+
+  const double recompute_ns = time_per_header( []( IPv4Header& h ) {
+    --h.ttl;
+    h.compute_checksum();
+  } );
+  const double incremental_ns = time_per_header( []( IPv4Header& h ) { h.decrement_ttl(); } );
+
+  cout << "TTL decrement: " << fixed << setprecision( 2 ) << recompute_ns << " ns/header recomputing the checksum, "
+       << incremental_ns << " ns/header updating it incrementally.\n";
+}
+
+void speed_test( const string_view name,
+                 const function<uint16_t( string_view )>& checksum,
+                 const size_t len,
+                 default_random_engine& rd )
+{
+  // one byte of slack so the data can start at an odd address, as a payload behind a header often does
+  string buffer( len + 1, 0 );
+  uniform_int_distribution<char> byte_dist;
+  for ( auto& ch : buffer ) {
+    ch = byte_dist( rd );
+  }
+  const string_view data = string_view { buffer }.substr( 1 );
+
+  const size_t iterations = max<size_t>( 300'000'000 / len, 1 );
+  uint32_t sink = 0;
+
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < iterations; ++i ) {
+    sink += checksum( data );
+  }
+  const auto stop_time = steady_clock::now();
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const auto gigabits_per_second = static_cast<double>( iterations * len ) * 8 / test_duration.count() / 1e9;
+  const auto ns_per_call = test_duration.count() * 1e9 / static_cast<double>( iterations );
+
+  cout << "  " << setw( 9 ) << name << " on " << setw( 5 ) << len << "-byte buffers: " << fixed
+       << setprecision( 2 ) << setw( 7 ) << gigabits_per_second << " Gbit/s, " << setw( 7 ) << ns_per_call
+       << " ns/call (" << hex << ( sink & 0xf ) << dec << ")\n";
+}
+
+// Compare copying a payload and then checksumming it (two passes over the bytes) with doing both at once
+void copy_test( const size_t len, default_random_engine& rd )
+{
+  string src( len, 0 );
+  uniform_int_distribution<char> byte_dist;
+  for ( auto& ch : src ) {
+    ch = byte_dist( rd );
+  }
+  // copy into a ring of destinations bigger than the caches, as a sender building segments would
+  vector<string> dsts( 32768, string( len, 0 ) );
+  const size_t iterations = max<size_t>( 1'000'000'000 / len, 1 );
+
+  const auto ns_per_segment = [&]( const auto& copy_and_sum ) {
+    uint32_t sink = 0;
+    const auto start_time = steady_clock::now();
+    for ( size_t i = 0; i < iterations; ++i ) {
+      sink += copy_and_sum( dsts[i % dsts.size()].data() );
+    }
+    const auto elapsed = duration_cast<duration<double, nano>>( steady_clock::now() - start_time );
+    if ( sink == 1 ) {
+      cout << " ";
+    }
+    return elapsed.count() / static_cast<double>( iterations );
+  };
+
+  cout << "Copy + checksum of " << len << "-byte segments:\n";
+  for ( const auto kernel : kernels ) {
+    if ( checksum_kernel_supported( kernel ) ) {
+      const double separate = ns_per_segment( [&]( char* dst ) {
+        memcpy( dst, src.data(), len );
+        return internet_checksum_partial( { dst, len }, kernel );
+      } );
+      const double fused
+        = ns_per_segment( [&]( char* dst ) { return internet_checksum_copy( dst, src, kernel ); } );
+      cout << "  " << setw( 9 ) << checksum_kernel_name( kernel ) << ": " << fixed << setprecision( 2 ) << setw( 7 )
+           << separate << " ns/segment copying then summing, " << setw( 7 ) << fused << " ns/segment fused\n";
+    }
+  }
+}
+
+void program_body()
+{
+  auto rd = get_random_engine();
+
+  const string_view best = checksum_kernel_name( best_checksum_kernel() );
+  cout << "Internet checksum kernels (" << best << " selected at runtime):\n";
+  for ( const size_t len : { 20, 1500, 65535 } ) {
+    speed_test( "bytewise", []( string_view data ) { return reference_checksum( { data } ); }, len, rd );
+    for ( const auto kernel : kernels ) {
+      if ( checksum_kernel_supported( kernel ) ) {
+        speed_test(
+          checksum_kernel_name( kernel ),
+          [kernel]( string_view data ) { return internet_checksum_partial( data, kernel ); },
+          len,
+          rd );
+      }
+    }
+    speed_test( "dispatch", []( string_view data ) { return internet_checksum_partial( data ); }, len, rd );
+  }
+
+  ttl_test( rd );
+  copy_test( 1500, rd );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+  debug_output << "             Internet checksum kernel: " << best << "\n";
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -35,6 +35,14 @@ inline ExpectationViolation::ExpectationViolation( const std::string& property_n
                            + ", but instead it was " + boolstr( actual ) + "." }
 {}
 
+// For tests that check an object directly, rather than through the steps of a TestHarness
+inline void expect( const bool condition, const std::string& what )
+{
+  if ( not condition ) {
+    throw ExpectationViolation { what };
+  }
+}
+
 template<class T>
 struct TestStep
 {
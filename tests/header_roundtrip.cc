@@ -0,0 +1,385 @@
+#include "address.hh"
+#include "arp_message.hh"
+#include "checksum.hh"
+#include "ethernet_header.hh"
+#include "header_codec.hh"
+#include "ipv4_datagram.hh"
+#include "ipv4_header.hh"
+#include "random.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// Field-by-field encoders, as the headers were serialized before they were described by a HeaderLayout
+string reference_encoding( const EthernetHeader& h )
+{
+  Serializer s;
+  for ( const auto b : h.dst ) {
+    s.integer( b );
+  }
+  for ( const auto b : h.src ) {
+    s.integer( b );
+  }
+  s.integer( h.type );
+  return string { s.finish().front() };
+}
+
+string reference_encoding( const ARPMessage& m )
+{
+  Serializer s;
+  s.integer( m.hardware_type );
+  s.integer( m.protocol_type );
+  s.integer( m.hardware_address_size );
+  s.integer( m.protocol_address_size );
+  s.integer( m.opcode );
+  for ( const auto b : m.sender_ethernet_address ) {
+    s.integer( b );
+  }
+  s.integer( m.sender_ip_address );
+  for ( const auto b : m.target_ethernet_address ) {
+    s.integer( b );
+  }
+  s.integer( m.target_ip_address );
+  return string { s.finish().front() };
+}
+
+string reference_encoding( const IPv4Header& h )
+{
+  Serializer s;
+  s.integer( static_cast<uint8_t>( h.ver << 4 | ( h.hlen & 0xfU ) ) );
+  s.integer( h.tos );
+  s.integer( h.len );
+  s.integer( h.id );
+  s.integer( static_cast<uint16_t>( ( h.df ? 0x4000U : 0 ) | ( h.mf ? 0x2000U : 0 ) | ( h.offset & 0x1fffU ) ) );
+  s.integer( h.ttl );
+  s.integer( h.proto );
+  s.integer( h.cksum );
+  s.integer( h.src );
+  s.integer( h.dst );
+  return string { s.finish().front() };
+}
+
+string reference_encoding( const TCPSegment& seg, const uint32_t seqno, const uint32_t ackno )
+{
+  const auto& msg = seg.message;
+  Serializer s;
+  s.integer( seg.udinfo.src_port );
+  s.integer( seg.udinfo.dst_port );
+  s.integer( seqno );
+  s.integer( msg.receiver.ackno.has_value() ? ackno : 0 );
+  s.integer( uint8_t { 5 << 4 } );
+  s.integer( static_cast<uint8_t>( ( msg.receiver.ackno.has_value() ? 0b0001'0000U : 0 )
+                                   | ( msg.sender.RST ? 0b0000'0100U : 0 ) | ( msg.sender.SYN ? 0b0000'0010U : 0 )
+                                   | ( msg.sender.FIN ? 0b0000'0001U : 0 ) ) );
+  s.integer( msg.receiver.window_size );
+  s.integer( seg.udinfo.cksum );
+  s.integer( uint16_t { 0 } );
+  return string { s.finish().front() };
+}
+
+string concat( const vector<Buffer>& buffers )
+{
+  string ret;
+  for ( const auto& buf : buffers ) {
+    ret += buf;
+  }
+  return ret;
+}
+
+// Serialize the header, check it against the reference encoding, then parse it back out of the bytes (in one
+// buffer, and split into two at every position) and check that it reserializes to the same bytes. Also check
+// that parsing a truncated header fails.
+template<class Header, typename... Targs>
+void check_roundtrip( const Header& original, const string& expected, Targs... args )
+{
+  const string wire = concat( serialize( original ) );
+  if ( wire.substr( 0, expected.size() ) != expected ) {
+    throw runtime_error( "serialized header differs from the reference encoding: " + original.to_string() );
+  }
+
+  for ( size_t split = 0; split <= wire.size(); ++split ) {
+    Header parsed {};
+    if ( not parse( parsed, vector<string> { wire.substr( 0, split ), wire.substr( split ) }, args... ) ) {
+      throw runtime_error( "failed to parse header split at byte " + to_string( split ) + ": "
+                           + original.to_string() );
+    }
+    if ( concat( serialize( parsed ) ) != wire ) {
+      throw runtime_error( "header split at byte " + to_string( split )
+                           + " did not round-trip: " + original.to_string() + " became " + parsed.to_string() );
+    }
+  }
+
+  Header truncated {};
+  if ( parse( truncated, vector<string> { wire.substr( 0, expected.size() - 1 ) }, args... ) ) {
+    throw runtime_error( "parsed a truncated header: " + original.to_string() );
+  }
+}
+
+// TCPSegment has no to_string() for the error messages
+struct PrintableSegment : TCPSegment
+{
+  string to_string() const
+  {
+    return "TCP segment " + std::to_string( udinfo.src_port ) + " -> " + std::to_string( udinfo.dst_port )
+           + " with " + std::to_string( message.sender.payload.size() ) + "-byte payload";
+  }
+};
+
+template<class T>
+T random_int( default_random_engine& rd, T lo = numeric_limits<T>::min(), T hi = numeric_limits<T>::max() )
+{
+  return static_cast<T>( uniform_int_distribution<uint64_t> { lo, hi }( rd ) );
+}
+
+EthernetAddress random_address( default_random_engine& rd )
+{
+  EthernetAddress ret {};
+  for ( auto& b : ret ) {
+    b = random_int<uint8_t>( rd );
+  }
+  return ret;
+}
+
+void check_ethernet( default_random_engine& rd )
+{
+  EthernetHeader h { random_address( rd ), random_address( rd ), random_int<uint16_t>( rd ) };
+  check_roundtrip( h, reference_encoding( h ) );
+}
+
+void check_arp( default_random_engine& rd )
+{
+  ARPMessage m;
+  m.opcode = random_int<uint8_t>( rd, 0, 1 ) ? ARPMessage::OPCODE_REQUEST : ARPMessage::OPCODE_REPLY;
+  m.sender_ethernet_address = random_address( rd );
+  m.sender_ip_address = random_int<uint32_t>( rd );
+  m.target_ethernet_address = random_address( rd );
+  m.target_ip_address = random_int<uint32_t>( rd );
+  check_roundtrip( m, reference_encoding( m ) );
+
+  // an unsupported message (here, with the wrong protocol address size) parses as an error
+  string wire = reference_encoding( m );
+  wire.at( 5 ) = 16;
+  if ( ARPMessage parsed; parse( parsed, vector<string> { wire } ) ) {
+    throw runtime_error( "parsed an unsupported ARP message" );
+  }
+}
+
+void check_ipv4( default_random_engine& rd )
+{
+  IPv4Header h;
+  h.tos = random_int<uint8_t>( rd );
+  h.len = random_int<uint16_t>( rd, IPv4Header::LENGTH );
+  h.id = random_int<uint16_t>( rd );
+  h.df = random_int<uint8_t>( rd, 0, 1 );
+  h.mf = random_int<uint8_t>( rd, 0, 1 );
+  h.offset = random_int<uint16_t>( rd, 0, 0x1fff );
+  h.ttl = random_int<uint8_t>( rd );
+  h.proto = random_int<uint8_t>( rd );
+  h.src = random_int<uint32_t>( rd );
+  h.dst = random_int<uint32_t>( rd );
+  h.compute_checksum();
+  check_roundtrip( h, reference_encoding( h ) );
+
+  // a corrupted header fails its checksum
+  string wire = reference_encoding( h );
+  wire.at( random_int<size_t>( rd, 0, wire.size() - 1 ) ) ^= static_cast<char>( random_int<uint8_t>( rd, 1 ) );
+  if ( IPv4Header parsed; parse( parsed, vector<string> { wire } ) ) {
+    throw runtime_error( "parsed a corrupted IPv4 header" );
+  }
+}
+
+void check_tcp( default_random_engine& rd )
+{
+  const uint32_t seqno = random_int<uint32_t>( rd );
+  const uint32_t ackno = random_int<uint32_t>( rd );
+  const uint32_t pseudo_checksum = random_int<uint16_t>( rd );
+
+  TCPSegment seg;
+  seg.udinfo.src_port = random_int<uint16_t>( rd );
+  seg.udinfo.dst_port = random_int<uint16_t>( rd );
+  seg.message.sender.seqno = Wrap32 { seqno };
+  seg.message.sender.SYN = random_int<uint8_t>( rd, 0, 1 );
+  seg.message.sender.FIN = random_int<uint8_t>( rd, 0, 1 );
+  seg.message.sender.RST = seg.message.receiver.RST = random_int<uint8_t>( rd, 0, 3 ) == 0;
+  if ( random_int<uint8_t>( rd, 0, 1 ) ) {
+    seg.message.receiver.ackno = Wrap32 { ackno };
+  }
+  seg.message.receiver.window_size = random_int<uint16_t>( rd );
+  string payload( random_int<size_t>( rd, 0, 8 ), 0 );
+  for ( auto& ch : payload ) {
+    ch = static_cast<char>( random_int<uint8_t>( rd ) );
+  }
+  seg.message.sender.payload = payload;
+  seg.compute_checksum( pseudo_checksum );
+
+  check_roundtrip( PrintableSegment { seg }, reference_encoding( seg, seqno, ackno ), pseudo_checksum );
+}
+
+// A segment's checksum is verified as it is parsed (ChecksumPolicy::Verify), or afterwards (Defer), or not at all
+// (Trust). The segment has options, which a deferred verification has to cover, and arrives split in two.
+void check_checksum_policies( default_random_engine& rd )
+{
+  const uint32_t pseudo_checksum = random_int<uint16_t>( rd );
+
+  TCPSegment seg;
+  seg.udinfo.src_port = random_int<uint16_t>( rd );
+  seg.udinfo.dst_port = random_int<uint16_t>( rd );
+  seg.message.receiver.ackno = Wrap32 { random_int<uint32_t>( rd ) };
+  string payload( random_int<size_t>( rd, 1, 100 ), 0 );
+  for ( auto& ch : payload ) {
+    ch = static_cast<char>( random_int<uint8_t>( rd ) );
+  }
+  seg.message.sender.payload = payload;
+
+  // insert options (NOPs) after the fixed-length header, and checksum the result
+  const size_t options_len = 4 * random_int<size_t>( rd, 0, 3 );
+  string wire = concat( serialize( seg ) );
+  wire.insert( TCPSegment::HEADER_LENGTH, string( options_len, 1 ) );
+  wire.at( 12 ) = static_cast<char>( ( TCPSegment::HEADER_LENGTH + options_len ) / 4 << 4 );
+  InternetChecksum check { pseudo_checksum };
+  check.add( wire );
+  wire.at( 16 ) = static_cast<char>( check.value() >> 8 );
+  wire.at( 17 ) = static_cast<char>( check.value() );
+
+  const auto parses = [&]( const string& bytes, const ChecksumPolicy policy ) {
+    const size_t split = random_int<size_t>( rd, 0, bytes.size() );
+    TCPSegment parsed;
+    vector<string> buffers { bytes.substr( 0, split ), bytes.substr( split ) };
+    const string_view expected_payload = string_view { bytes }.substr( bytes.size() - payload.size() );
+    if ( not parse( parsed, move( buffers ), pseudo_checksum, policy )
+         or parsed.message.sender.payload.view() != expected_payload ) {
+      return false;
+    }
+    return policy != ChecksumPolicy::Defer or parsed.verify_checksum( pseudo_checksum );
+  };
+
+  for ( const auto policy : { ChecksumPolicy::Verify, ChecksumPolicy::Defer, ChecksumPolicy::Trust } ) {
+    if ( not parses( wire, policy ) ) {
+      throw runtime_error( "failed to parse a TCP segment with " + to_string( options_len ) + " bytes of options" );
+    }
+  }
+
+  // corrupt a byte of the options or payload
+  string corrupted = wire;
+  corrupted.at( random_int<size_t>( rd, TCPSegment::HEADER_LENGTH, wire.size() - 1 ) )
+    ^= static_cast<char>( random_int<uint8_t>( rd, 1 ) );
+  if ( parses( corrupted, ChecksumPolicy::Verify ) or parses( corrupted, ChecksumPolicy::Defer ) ) {
+    throw runtime_error( "accepted a corrupted TCP segment" );
+  }
+  if ( not parses( corrupted, ChecksumPolicy::Trust ) ) {
+    throw runtime_error( "failed to parse a corrupted TCP segment with ChecksumPolicy::Trust" );
+  }
+}
+
+// TCPOverIPv4Adapter builds its headers from a cached template. Check that the datagrams it sends have the right
+// lengths and checksums, and carry their messages intact to a peer, including after the addresses change.
+void check_encapsulation( default_random_engine& rd )
+{
+  TCPOverIPv4Adapter a;
+  TCPOverIPv4Adapter b;
+
+  for ( unsigned int round = 0; round < 20; round++ ) {
+    const auto random_address = [&] {
+      return Address { "10." + to_string( random_int<uint8_t>( rd ) ) + "." + to_string( random_int<uint8_t>( rd ) )
+                         + "." + to_string( random_int<uint8_t>( rd ) ),
+                       random_int<uint16_t>( rd ) };
+    };
+    a.config_mut().source = b.config_mut().destination = random_address();
+    a.config_mut().destination = b.config_mut().source = random_address();
+
+    for ( unsigned int i = 0; i < 50; i++ ) {
+      TCPMessage msg;
+      msg.sender.seqno = Wrap32 { random_int<uint32_t>( rd ) };
+      msg.sender.SYN = random_int<uint8_t>( rd, 0, 1 );
+      msg.sender.payload = string( random_int<size_t>( rd, 0, 1500 ), 'x' );
+      msg.sender.FIN = random_int<uint8_t>( rd, 0, 1 );
+      if ( random_int<uint8_t>( rd, 0, 1 ) ) {
+        msg.receiver.ackno = Wrap32 { random_int<uint32_t>( rd ) };
+      }
+      msg.receiver.window_size = random_int<uint16_t>( rd );
+
+      InternetDatagram dgram = a.wrap_tcp_in_ip( msg );
+      IPv4Header recomputed = dgram.header;
+      recomputed.compute_checksum();
+      if ( dgram.header.len != IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + msg.sender.payload.size()
+           or dgram.header.cksum != recomputed.cksum ) {
+        throw runtime_error( "wrong length or checksum in encapsulating IPv4 header: " + dgram.header.to_string() );
+      }
+
+      InternetDatagram received;
+      if ( not parse( received, serialize( dgram ) ) ) {
+        throw runtime_error( "failed to parse encapsulating IPv4 datagram: " + dgram.header.to_string() );
+      }
+      const auto unwrapped = b.unwrap_tcp_in_ip( move( received ) );
+      if ( not unwrapped.has_value() or not( unwrapped->sender.seqno == msg.sender.seqno )
+           or unwrapped->sender.SYN != msg.sender.SYN or unwrapped->sender.FIN != msg.sender.FIN
+           or unwrapped->sender.payload.view() != msg.sender.payload.view()
+           or unwrapped->receiver.ackno != msg.receiver.ackno
+           or unwrapped->receiver.window_size != msg.receiver.window_size ) {
+        throw runtime_error( "TCP message did not survive encapsulation from " + a.config().source.to_string()
+                             + " to " + a.config().destination.to_string() );
+      }
+
+      // the other end, which has no connection from this address, drops it
+      if ( a.unwrap_tcp_in_ip( a.wrap_tcp_in_ip( msg ) ).has_value() ) {
+        throw runtime_error( "adapter accepted its own segment" );
+      }
+    }
+  }
+}
+
+// Bitfields sharing bytes are set without disturbing each other, and values are truncated to their widths
+void check_fields()
+{
+  using High = HeaderField<0, 4>;
+  using Low = HeaderField<4, 4>;
+  using Straddling = HeaderField<11, 10>; // from bit 3 of byte 1 through bit 4 of byte 2
+
+  string raw( 4, 0 );
+  High::set( raw.data(), 0xa );
+  Low::set( raw.data(), 0x5 );
+  Straddling::set( raw.data(), 0xffff );
+  if ( raw != string { "\xa5\x1f\xf8\x00", 4 } or High::get( raw.data() ) != 0xa or Low::get( raw.data() ) != 0x5
+       or Straddling::get( raw.data() ) != 0x3ff ) {
+    throw runtime_error( "HeaderField bitfields interfere with each other" );
+  }
+
+  High::set( raw.data(), 0 );
+  Straddling::set( raw.data(), 0x155 );
+  if ( raw != string { "\x05\x0a\xa8\x00", 4 } ) {
+    throw runtime_error( "HeaderField did not overwrite a bitfield" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    check_fields();
+    for ( unsigned int i = 0; i < 1000; i++ ) {
+      check_ethernet( rd );
+      check_arp( rd );
+      check_ipv4( rd );
+      check_tcp( rd );
+      check_checksum_policies( rd );
+    }
+    check_encapsulation( rd );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "neighbor_table.hh"
+#include "network_interface.hh"
+#include "random.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t neighbor_count = 10'000;
+constexpr size_t packet_count = 4'000'000;
+
+class CountingPort : public NetworkInterface::OutputPort
+{
+public:
+  size_t frames {};
+  void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x [[maybe_unused]] ) override
+  {
+    ++frames;
+  }
+};
+
+EthernetAddress neighbor_mac( const uint32_t ip_address )
+{
+  return { 0x02, 0, static_cast<uint8_t>( ip_address >> 24 ), static_cast<uint8_t>( ip_address >> 16 ),
+           static_cast<uint8_t>( ip_address >> 8 ), static_cast<uint8_t>( ip_address ) };
+}
+
+template<class Resolve>
+double ns_per_packet( const vector<uint32_t>& next_hops, Resolve&& resolve )
+{
+  uint64_t sink = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < packet_count; ++i ) {
+    sink += resolve( next_hops[i & ( next_hops.size() - 1 )] ); // (a power of two long)
+  }
+  const auto elapsed = duration_cast<duration<double, nano>>( steady_clock::now() - start_time );
+  if ( sink == 1 ) {
+    cout << " ";
+  }
+  return elapsed.count() / static_cast<double>( packet_count );
+}
+
+// The cost of finding the Ethernet address of each packet's next hop, among 10k resolved neighbors: in the
+// neighbor table, and in the node-based map of mappings it replaced
+void resolve_test( const vector<uint32_t>& neighbors, const vector<uint32_t>& next_hops )
+{
+  struct MacAddrUnit
+  {
+    EthernetAddress mac_addr_ {};
+    microseconds learning_time_ {};
+  };
+  unordered_map<uint32_t, MacAddrUnit> map_ip;
+  NeighborTable table;
+  for ( const uint32_t ip_address : neighbors ) {
+    map_ip[ip_address] = { neighbor_mac( ip_address ), {} };
+    auto* neighbor = table.insert( ip_address );
+    neighbor->mapped = true;
+    neighbor->header.dst = neighbor_mac( ip_address );
+  }
+
+  const microseconds now { 1'000'000 };
+  const double map_ns = ns_per_packet( next_hops, [&]( const uint32_t ip_address ) -> uint64_t {
+    const auto it = map_ip.find( ip_address );
+    if ( it == map_ip.end() or now - it->second.learning_time_ >= seconds { 30 } ) {
+      return 0;
+    }
+    return it->second.mac_addr_[5];
+  } );
+  const double table_ns = ns_per_packet( next_hops, [&]( const uint32_t ip_address ) -> uint64_t {
+    const auto* neighbor = table.find( ip_address );
+    if ( not neighbor or not neighbor->mapped or now - neighbor->learned >= seconds { 30 } ) {
+      return 0;
+    }
+    return neighbor->header.dst[5];
+  } );
+
+  cout << "Resolving next hops among " << neighbors.size() << " neighbors: " << fixed << setprecision( 2 )
+       << setw( 6 ) << map_ns << " ns/packet with unordered_map, " << setw( 6 ) << table_ns
+       << " ns/packet with NeighborTable\n";
+}
+
+// The whole of NetworkInterface::send_datagram (including serializing the frame) to those neighbors
+void send_test( const vector<uint32_t>& neighbors, const vector<uint32_t>& next_hops )
+{
+  const auto port = make_shared<CountingPort>();
+  const EthernetAddress local_mac { 0x02, 0, 0, 0, 0, 1 };
+  NetworkInterface iface { "speed", port, local_mac, Address { "10.0.0.1" } };
+
+  for ( const uint32_t ip_address : neighbors ) {
+    ARPMessage reply;
+    reply.opcode = ARPMessage::OPCODE_REPLY;
+    reply.sender_ethernet_address = neighbor_mac( ip_address );
+    reply.sender_ip_address = ip_address;
+    reply.target_ethernet_address = local_mac;
+    reply.target_ip_address = Address { "10.0.0.1" }.ipv4_numeric();
+    const EthernetHeader header { local_mac, reply.sender_ethernet_address, EthernetHeader::TYPE_ARP };
+    iface.recv_frame( EthernetFrame { header, serialize( reply ) } );
+  }
+  if ( iface.neighbor_count() != neighbors.size() ) {
+    throw runtime_error( "NetworkInterface didn't learn every neighbor" );
+  }
+
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.0.1" }.ipv4_numeric();
+  dgram.header.dst = Address { "1.2.3.4" }.ipv4_numeric();
+  dgram.payload.emplace_back( string( 64, 'x' ) );
+  dgram.header.len = static_cast<uint16_t>( dgram.header.hlen * 4 + 64 );
+  dgram.header.compute_checksum();
+
+  vector<Address> addresses;
+  addresses.reserve( next_hops.size() );
+  for ( const uint32_t ip_address : next_hops ) {
+    addresses.push_back( Address::from_ipv4_numeric( ip_address ) );
+  }
+
+  const double send_ns = ns_per_packet( next_hops, [&, i = size_t {}]( uint32_t ) mutable -> uint64_t {
+    iface.send_datagram( dgram, addresses[i++ & ( addresses.size() - 1 )] );
+    return 0;
+  } );
+  if ( port->frames != packet_count ) {
+    throw runtime_error( "NetworkInterface sent " + to_string( port->frames ) + " frames, expected "
+                         + to_string( packet_count ) );
+  }
+
+  cout << "NetworkInterface::send_datagram to " << neighbors.size() << " resolved neighbors: " << fixed
+       << setprecision( 2 ) << setw( 6 ) << send_ns << " ns/packet\n";
+}
+
+void program_body()
+{
+  auto rd = get_random_engine();
+
+  // neighbors scattered over a /16, visited in a random order
+  vector<uint32_t> neighbors;
+  for ( uint32_t i = 0; neighbors.size() < neighbor_count; i += 3 ) {
+    neighbors.push_back( 0x0a000000 + i * 7 % 0x10000 );
+  }
+  vector<uint32_t> next_hops( 1 << 16 );
+  uniform_int_distribution<size_t> pick { 0, neighbors.size() - 1 };
+  for ( auto& ip_address : next_hops ) {
+    ip_address = neighbors[pick( rd )];
+  }
+
+  resolve_test( neighbors, next_hops );
+  send_test( neighbors, next_hops );
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
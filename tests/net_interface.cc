@@ -4,6 +4,7 @@
 #include "network_interface_test_harness.hh"
 
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <random>
 
@@ -50,7 +51,7 @@ ARPMessage make_arp( const uint16_t opcode,
 EthernetFrame make_frame( const EthernetAddress& src,
                           const EthernetAddress& dst,
                           const uint16_t type,
-                          vector<string> payload )
+                          vector<Buffer> payload )
 {
   EthernetFrame frame;
   frame.header.src = src;
@@ -320,6 +321,298 @@ int main()
         serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
       test.execute( ExpectNoFrame {} );
     }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "pending datagrams are bounded", local_eth, Address( "1.2.3.4", 0 ) };
+
+      vector<InternetDatagram> datagrams;
+      for ( int i = 0; i < 20; ++i ) {
+        datagrams.push_back( make_datagram( "5.6.7.8", "13.12.11." + to_string( i ) ) );
+        test.execute( SendDatagram { datagrams.back(), Address( "10.0.0.1", 0 ) } );
+      }
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( PendingDatagrams { 16 } );
+      test.execute( DatagramsDropped { 4 } );
+
+      // the reply releases the newest datagrams, in order
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      for ( size_t i = 4; i < datagrams.size(); ++i ) {
+        test.execute( ExpectFrame {
+          make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagrams.at( i ) ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+      test.execute( PendingDatagrams { 0 } );
+      test.execute( NeighborCount { 1 } );
+
+      // the mapping ages out
+      test.execute( Tick { 30000 } );
+      test.execute( NeighborCount { 0 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "unresolved datagrams age out", local_eth, Address( "1.2.3.4", 0 ) };
+
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) ) } );
+      test.execute( Tick { 4990 } );
+      test.execute( NeighborCount { 1 } );
+      test.execute( PendingDatagrams { 1 } );
+
+      // the request is resent twice, waiting twice as long each time, and then the datagram is dropped
+      const auto request = make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) );
+      test.execute( Tick { 20 } );
+      test.execute( ExpectFrame { request } );
+      test.execute( Tick { 10000 } );
+      test.execute( ExpectFrame { request } );
+      test.execute( Tick { 19980 } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( NeighborCount { 1 } );
+      test.execute( Tick { 20 } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( NeighborCount { 0 } );
+      test.execute( PendingDatagrams { 0 } );
+      test.execute( DatagramsDropped { 1 } );
+
+      // a late reply is learned, but there's nothing left to send
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( NeighborCount { 1 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "ARP state is bounded under a scan", local_eth, Address( "10.0.0.1", 0 ) };
+
+      // send to 20,000 hosts that never answer
+      for ( uint32_t i = 0; i < 20000; ++i ) {
+        const auto next_hop = Address::from_ipv4_numeric( 0x0b000000 + i );
+        test.execute( SendDatagram { make_datagram( "10.0.0.1", "13.12.11.10" ), next_hop } );
+      }
+      test.execute( NeighborCount { NeighborTable::MAX_NEIGHBORS } );
+      test.execute( PendingDatagrams { NeighborTable::MAX_PENDING } );
+      test.execute( DatagramsDropped { 20000 - NeighborTable::MAX_PENDING } );
+
+      // and keep scanning as the first ones age out
+      for ( uint32_t i = 20000; i < 25000; ++i ) {
+        test.execute( Tick { 1 } );
+        const auto next_hop = Address::from_ipv4_numeric( 0x0b000000 + i );
+        test.execute( SendDatagram { make_datagram( "10.0.0.1", "13.12.11.10" ), next_hop } );
+      }
+      // (after two retries each)
+      for ( int i = 0; i < 40; ++i ) {
+        test.execute( Tick { 1000 } );
+      }
+      test.execute( NeighborCount { 0 } );
+      test.execute( PendingDatagrams { 0 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "lost ARP request is resent", local_eth, Address( "1.2.3.4", 0 ) };
+
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.10" );
+      const auto request = make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) );
+      test.execute( SendDatagram { datagram, Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame { request } );
+
+      // the request is lost, and nothing else is sent: the interface asks again by itself
+      test.execute( Tick { 4999 } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectFrame { request } );
+      test.execute( ExpectNoFrame {} );
+
+      // the retry is lost too
+      test.execute( Tick { 9999 } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectFrame { request } );
+      test.execute( ExpectNoFrame {} );
+
+      // the datagram goes out as soon as the reply arrives
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) } );
+      test.execute( Tick { 30000 } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "ARP retry answered during transmit", local_eth, Address( "1.2.3.4", 0 ) };
+
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.10" );
+      const auto request = make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) );
+      test.execute( SendDatagram { datagram, Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame { request } );
+
+      // the first request is lost, and the retry is answered before the port returns, by which time the neighbor
+      // table has grown (and moved the next hop's entry) many times over
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( AnswerARPRequests { remote_eth, Address( "10.0.0.1", 0 ), 1000 } );
+      test.execute( Tick { 5000 } );
+      test.execute( ExpectFrame { request } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( NeighborCount { 1001 } );
+
+      // and the next hop's mapping ages out as usual
+      test.execute( Tick { 29999 } );
+      test.execute( NeighborCount { 1001 } );
+      test.execute( Tick { 5001 } );
+      test.execute( NeighborCount { 0 } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "active mapping is refreshed before it expires", local_eth, Address( "1.2.3.4", 0 ) };
+
+      const auto reply = make_frame(
+        remote_eth,
+        local_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) );
+      const auto probe = make_frame(
+        local_eth,
+        remote_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) );
+      const auto expect_sent = [&]( const InternetDatagram& dgram ) {
+        test.execute( SendDatagram { dgram, Address( "10.0.0.1", 0 ) } );
+        test.execute(
+          ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( dgram ) ) } );
+      };
+      test.execute( ReceiveFrame { reply, {} } );
+
+      // shortly before the mapping expires, sending to it also asks the neighbor (directly) to confirm it
+      test.execute( Tick { 26999 } );
+      expect_sent( make_datagram( "5.6.7.8", "13.12.11.10" ) );
+      test.execute( ExpectNoFrame {} );
+      test.execute( Tick { 1 } );
+      expect_sent( make_datagram( "5.6.7.8", "13.12.11.11" ) );
+      test.execute( ExpectFrame { probe } );
+      expect_sent( make_datagram( "5.6.7.8", "13.12.11.12" ) );
+      test.execute( ExpectNoFrame {} );
+
+      // the first request goes unanswered, so the next datagram a second later asks again
+      test.execute( Tick { 1000 } );
+      expect_sent( make_datagram( "5.6.7.8", "13.12.11.13" ) );
+      test.execute( ExpectFrame { probe } );
+      test.execute( ReceiveFrame { reply, {} } );
+      test.execute( ExpectNoFrame {} );
+
+      // traffic keeps flowing past the original expiry, without waiting for ARP
+      test.execute( Tick { 5000 } );
+      expect_sent( make_datagram( "5.6.7.8", "13.12.11.14" ) );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      const EthernetAddress next_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "received datagram is forwarded", local_eth, Address( "1.2.3.4", 0 ) };
+
+      test.execute( ReceiveFrame {
+        make_frame(
+          next_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, next_eth, "10.0.0.2", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+
+      // arriving in one piece (as from a NIC, which may pad it to the minimum frame size), or in several, it leaves
+      // with just the TTL changed
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.10" );
+      const string wire = concat( serialize( datagram ) );
+      const string padded = wire + string( 46 - wire.size(), 0 );
+      for ( const auto& payload : { vector<Buffer> { wire }, vector<Buffer> { padded }, serialize( datagram ) } ) {
+        test.execute( ForwardDatagram { make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, payload ),
+                                        Address( "10.0.0.2", 0 ) } );
+        auto forwarded = datagram;
+        forwarded.header.decrement_ttl();
+        test.execute(
+          ExpectFrame { make_frame( local_eth, next_eth, EthernetHeader::TYPE_IPv4, serialize( forwarded ) ) } );
+        test.execute( ExpectNoFrame {} );
+      }
+
+      // a payload changed on the way (replaced, edited in place, or cut short, with the header to match) leaves as
+      // it was changed, not as it arrived
+      const vector<function<void( InternetDatagram& )>> edits {
+        []( InternetDatagram& dgram ) {
+          dgram.payload = { Buffer { string { "goodbye, world" } } };
+          dgram.header.len = IPv4Header::LENGTH + 14;
+          dgram.header.compute_checksum();
+        },
+        []( InternetDatagram& dgram ) { dgram.payload.front().mutable_data()[0] = 'j'; },
+        []( InternetDatagram& dgram ) {
+          dgram.payload.front().remove_suffix( 3 );
+          dgram.header.len -= 3;
+          dgram.header.compute_checksum();
+        } };
+      for ( const auto& edit : edits ) {
+        for ( const auto& payload : { vector<Buffer> { wire }, serialize( datagram ) } ) {
+          test.execute( ForwardDatagram { make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, payload ),
+                                          Address( "10.0.0.2", 0 ),
+                                          edit } );
+          auto forwarded = datagram;
+          edit( forwarded );
+          forwarded.header.decrement_ttl();
+          test.execute(
+            ExpectFrame { make_frame( local_eth, next_eth, EthernetHeader::TYPE_IPv4, serialize( forwarded ) ) } );
+          test.execute( ExpectNoFrame {} );
+        }
+      }
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return EXIT_FAILURE;
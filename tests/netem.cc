@@ -0,0 +1,204 @@
+#include "common.hh"
+#include "loopback_adapter.hh"
+#include "netem_fd_adapter.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr unsigned SEED = 144;
+
+// A NetemFdAdapter whose uplink impairments are `cfg`, with its random engine seeded by SEED, writing to a
+// LoopbackAdapter that the test reads from
+struct Path
+{
+  NetemFdAdapter<LoopbackAdapter> netem;
+  LoopbackAdapter far_end;
+  microseconds now {};
+
+  explicit Path( const NetemConfig& cfg,
+                 pair<LoopbackAdapter, LoopbackAdapter> ends = LoopbackAdapter::make_pair() )
+    : netem( move( ends.first ), default_random_engine { SEED } ), far_end( move( ends.second ) )
+  {
+    netem.config_mut().netem_up = cfg;
+  }
+
+  void send( const uint32_t number, const size_t payload_size = 0 )
+  {
+    TCPMessage msg;
+    msg.sender.seqno = Wrap32 { number };
+    msg.sender.payload = string( payload_size, 'x' );
+    netem.write( msg );
+  }
+
+  // The numbers of the datagrams that have arrived
+  vector<uint32_t> receive()
+  {
+    vector<uint32_t> numbers;
+    while ( auto msg = far_end.read() ) {
+      numbers.push_back( msg->sender.seqno.unwrap( Wrap32 { 0 }, 0 ) );
+    }
+    return numbers;
+  }
+
+  void tick( const microseconds t )
+  {
+    netem.tick( t );
+    now += t;
+  }
+};
+
+// Each datagram is serialized at the bottleneck's rate behind the ones ahead of it, then delayed
+void check_delay_and_rate()
+{
+  NetemConfig cfg;
+  cfg.delay = 10ms;
+  cfg.rate = 1'000'000; // bytes per second, so a datagram of 960 bytes (plus 40 of headers) takes 1 ms
+  Path path { cfg };
+  for ( uint32_t i = 0; i < 3; ++i ) {
+    path.send( i, 960 );
+  }
+
+  vector<pair<uint32_t, microseconds>> arrivals;
+  while ( path.now < 20ms ) {
+    path.tick( 100us );
+    for ( const uint32_t number : path.receive() ) {
+      arrivals.emplace_back( number, path.now );
+    }
+  }
+  const vector<pair<uint32_t, microseconds>> expected { { 0, 11ms }, { 1, 12ms }, { 2, 13ms } };
+  expect( arrivals == expected, "datagrams didn't arrive after the bottleneck and the delay" );
+  expect( not path.netem.next_timeout().has_value(), "datagrams still in flight" );
+}
+
+// Jitter keeps each datagram's delay within the bounds
+void check_jitter()
+{
+  NetemConfig cfg;
+  cfg.delay = 10ms;
+  cfg.jitter = 2ms;
+  Path path { cfg };
+  vector<microseconds> sent;
+  microseconds shortest = 1s;
+  microseconds longest {};
+  for ( uint32_t i = 0; i < 1000; ++i ) {
+    path.send( i );
+    sent.push_back( path.now );
+    path.tick( 100us );
+    for ( const uint32_t number : path.receive() ) {
+      shortest = min( shortest, path.now - sent.at( number ) );
+      longest = max( longest, path.now - sent.at( number ) );
+    }
+  }
+  // (arrivals are seen at the next tick, up to 100 us late)
+  expect( shortest >= 8ms and shortest < 8ms + 200us, "jitter didn't shorten the delay by up to 2 ms" );
+  expect( longest > 12ms - 100us and longest <= 12ms + 100us, "jitter didn't lengthen the delay by up to 2 ms" );
+}
+
+// Once the bottleneck queue is full, datagrams are dropped until one leaves it
+void check_queue_limit()
+{
+  NetemConfig cfg;
+  cfg.rate = 1'000'000;
+  cfg.queue_limit = 4;
+  Path path { cfg };
+  for ( uint32_t i = 0; i < 10; ++i ) {
+    path.send( i, 960 );
+  }
+  path.tick( 1ms );
+  path.send( 10, 960 ); // (the first has left the queue)
+  path.send( 11, 960 );
+  path.tick( 10ms );
+  expect( path.receive() == vector<uint32_t> { 0, 1, 2, 3, 10 }, "the full queue didn't drop the right datagrams" );
+}
+
+// Datagrams sent one after another arrive in order, unless reordering is enabled
+size_t out_of_order( const uint16_t reorder_rate )
+{
+  NetemConfig cfg;
+  cfg.delay = 5ms;
+  cfg.reorder_rate = reorder_rate;
+  Path path { cfg };
+  vector<uint32_t> arrivals;
+  for ( uint32_t i = 0; i < 1000; ++i ) {
+    path.send( i );
+    path.tick( 100us );
+    for ( const uint32_t number : path.receive() ) {
+      arrivals.push_back( number );
+    }
+  }
+  path.tick( 10ms );
+  for ( const uint32_t number : path.receive() ) {
+    arrivals.push_back( number );
+  }
+
+  expect( arrivals.size() == 1000, "datagrams were lost with no loss configured" );
+  size_t count = 0;
+  for ( size_t i = 1; i < arrivals.size(); ++i ) {
+    count += arrivals[i] < arrivals[i - 1];
+  }
+  return count;
+}
+
+void check_reordering()
+{
+  expect( out_of_order( 0 ) == 0, "datagrams were reordered with reordering disabled" );
+  const size_t reordered = out_of_order( 65536 / 10 );
+  expect( reordered > 50 and reordered < 150, "about 10% of datagrams should have been reordered" );
+}
+
+// The fraction of datagrams lost under a Gilbert-Elliott loss model
+double loss_rate( const NetemConfig& cfg )
+{
+  constexpr uint32_t count = 20'000;
+  Path path { cfg };
+  for ( uint32_t i = 0; i < count; ++i ) {
+    path.send( i );
+  }
+  return 1.0 - static_cast<double>( path.receive().size() ) / count;
+}
+
+void check_loss()
+{
+  NetemConfig cfg;
+  cfg.loss_bad = 65536 * 3 / 10;
+  expect( loss_rate( cfg ) == 0, "datagrams were lost in the good state, with no loss there" );
+
+  cfg.good_to_bad = 65535; // (into the bad state at once, and there to stay)
+  const double bad = loss_rate( cfg );
+  expect( bad > 0.28 and bad < 0.32, "the bad state lost " + to_string( bad ) + " of datagrams, not 0.3" );
+
+  cfg.good_to_bad = cfg.bad_to_good = 65536 / 10; // (half the time in each state)
+  const double mixed = loss_rate( cfg );
+  expect( mixed > 0.12 and mixed < 0.18, "lost " + to_string( mixed ) + " of datagrams, not 0.15" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    check_delay_and_rate();
+    check_jitter();
+    check_queue_limit();
+    check_reordering();
+    check_loss();
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <compare>
+#include <functional>
 #include <optional>
 #include <utility>
 
@@ -12,7 +13,14 @@ class FramesOut : public NetworkInterface::OutputPort
 {
 public:
   std::queue<EthernetFrame> frames {};
-  void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x ) override { frames.push( x ); }
+  std::function<void( const EthernetFrame& )> on_transmit {}; // (called as each frame is sent, after it's queued)
+  void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x ) override
+  {
+    frames.push( x );
+    if ( on_transmit ) {
+      on_transmit( x );
+    }
+  }
 };
 
 using Output = std::shared_ptr<FramesOut>;
@@ -49,16 +57,18 @@ struct SendDatagram : public Action<InterfaceAndOutput>
   SendDatagram( InternetDatagram d, Address n ) : dgram( std::move( d ) ), next_hop( n ) {}
 };
 
-inline std::string concat( const std::vector<std::string>& buffers )
+inline std::string concat( const std::vector<Buffer>& buffers )
 {
-  return std::accumulate( buffers.begin(), buffers.end(), std::string {} );
+  return std::accumulate( buffers.begin(), buffers.end(), std::string {}, []( std::string x, const Buffer& y ) {
+    return std::move( x.append( y.view() ) );
+  } );
 }
 
 template<class T>
 bool equal( const T& t1, const T& t2 )
 {
-  const std::vector<std::string> t1s = serialize( t1 );
-  const std::vector<std::string> t2s = serialize( t2 );
+  const std::vector<Buffer> t1s = serialize( t1 );
+  const std::vector<Buffer> t2s = serialize( t2 );
 
   return concat( t1s ) == concat( t2s );
 }
@@ -103,6 +113,47 @@ struct ReceiveFrame : public Action<InterfaceAndOutput>
   {}
 };
 
+// A frame arrives (in bytes of its own, as from a NIC), and the datagram it carries is sent back out, as a router
+// does (with its TTL decremented, and after any `edit`, as by a NAT)
+struct ForwardDatagram : public Action<InterfaceAndOutput>
+{
+  EthernetFrame frame;
+  Address next_hop;
+  std::function<void( InternetDatagram& )> edit {};
+
+  std::string description() const override
+  {
+    return "frame arrives (" + summary( frame ) + ") and is " + ( edit ? "edited and " : "" )
+           + "forwarded to next hop " + next_hop.ip();
+  }
+
+  void execute( InterfaceAndOutput& interface ) const override
+  {
+    EthernetFrame arriving { frame.header, {} };
+    for ( const auto& buffer : frame.payload ) {
+      arriving.payload.emplace_back( std::string { buffer.view() } );
+    }
+    interface.first.recv_frame( std::move( arriving ) );
+
+    auto& inbound = interface.first.datagrams_received();
+    if ( inbound.empty() ) {
+      throw ExpectationViolation(
+        "an arriving Ethernet frame was expected to be passed up the stack as an Internet datagram, but wasn't" );
+    }
+    NetworkInterface::OutboundDatagram outbound { std::move( inbound.front() ), next_hop.ipv4_numeric() };
+    inbound.pop();
+    if ( edit ) {
+      edit( outbound.dgram );
+    }
+    outbound.dgram.header.decrement_ttl();
+    interface.first.send_datagrams( { &outbound, 1 } );
+  }
+
+  ForwardDatagram( EthernetFrame f, Address n, std::function<void( InternetDatagram& )> e = {} )
+    : frame( std::move( f ) ), next_hop( n ), edit( std::move( e ) )
+  {}
+};
+
 struct ExpectFrame : public Expectation<InterfaceAndOutput>
 {
   EthernetFrame expected;
@@ -137,6 +188,51 @@ struct ExpectNoFrame : public Expectation<InterfaceAndOutput>
   }
 };
 
+// From now on, the port answers an ARP request for `ip` as soon as it is sent, delivering the reply straight back
+// to the interface (as a port wired to another interface in the same thread would), after unsolicited replies from
+// `others` other hosts (which the interface learns, so its neighbor table grows and moves its entries)
+struct AnswerARPRequests : public Action<InterfaceAndOutput>
+{
+  EthernetAddress eth;
+  Address ip;
+  uint32_t others;
+
+  std::string description() const override
+  {
+    return "the port answers ARP requests for " + ip.ip() + " synchronously, after " + std::to_string( others )
+           + " other hosts announce themselves";
+  }
+
+  void execute( InterfaceAndOutput& interface ) const override
+  {
+    interface.second->on_transmit = [&iface = interface.first, answer = *this]( const EthernetFrame& frame ) {
+      ARPMessage request;
+      if ( frame.header.type != EthernetHeader::TYPE_ARP or not parse( request, frame.payload )
+           or request.opcode != ARPMessage::OPCODE_REQUEST
+           or request.target_ip_address != answer.ip.ipv4_numeric() ) {
+        return;
+      }
+      const auto reply_from = [&]( const EthernetAddress& sender_eth, const uint32_t sender_ip ) {
+        ARPMessage reply;
+        reply.opcode = ARPMessage::OPCODE_REPLY;
+        reply.sender_ethernet_address = sender_eth;
+        reply.sender_ip_address = sender_ip;
+        reply.target_ethernet_address = request.sender_ethernet_address;
+        reply.target_ip_address = request.sender_ip_address;
+        iface.recv_frame(
+          { { request.sender_ethernet_address, sender_eth, EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+      };
+      for ( uint32_t i = 0; i < answer.others; ++i ) {
+        reply_from( answer.eth, 0x0c000000 + i );
+      }
+      reply_from( answer.eth, answer.ip.ipv4_numeric() );
+    };
+  }
+
+  AnswerARPRequests( const EthernetAddress& e, const Address& i, const uint32_t o ) : eth( e ), ip( i ), others( o )
+  {}
+};
+
 struct Tick : public Action<InterfaceAndOutput>
 {
   size_t _ms;
@@ -147,6 +243,34 @@ struct Tick : public Action<InterfaceAndOutput>
   explicit Tick( const size_t ms ) : _ms( ms ) {}
 };
 
+struct NeighborCount : public ConstExpectNumber<InterfaceAndOutput, size_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "neighbor_count"; }
+  size_t value( const InterfaceAndOutput& interface ) const override { return interface.first.neighbor_count(); }
+};
+
+struct PendingDatagrams : public ConstExpectNumber<InterfaceAndOutput, size_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "pending_datagram_count"; }
+  size_t value( const InterfaceAndOutput& interface ) const override
+  {
+    return interface.first.pending_datagram_count();
+  }
+};
+
+struct DatagramsDropped : public ConstExpectNumber<InterfaceAndOutput, uint64_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "datagrams dropped waiting for ARP"; }
+  uint64_t value( const InterfaceAndOutput& interface ) const override
+  {
+    const auto& stats = interface.first.arp_stats();
+    return stats.queue_full_drops + stats.table_full_drops + stats.unresolved_drops;
+  }
+};
+
 inline std::string summary( const EthernetFrame& frame )
 {
   std::string out = frame.header.to_string() + " payload: ";
@@ -0,0 +1,229 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+// Serialize a TCP segment in an IPv4 datagram, laid out in buffers as a TUN read would produce them
+vector<string> make_packet( const size_t payload_len, const bool split_headers )
+{
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "10.0.0.1", 1000 };
+  adapter.config_mut().destination = Address { "10.0.0.2", 2000 };
+
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { 12345 };
+  msg.sender.payload = string( payload_len, 'x' );
+  msg.receiver.ackno = Wrap32 { 67890 };
+  msg.receiver.window_size = 64000;
+
+  string wire;
+  for ( const auto& buf : serialize( adapter.wrap_tcp_in_ip( msg ) ) ) {
+    wire += buf;
+  }
+
+  if ( not split_headers ) {
+    return { wire };
+  }
+  return { wire.substr( 0, IPv4Header::LENGTH ),
+           wire.substr( IPv4Header::LENGTH, TCPSegment::HEADER_LENGTH ),
+           wire.substr( IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH ) };
+}
+
+// Parse the IPv4 and TCP headers of many copies of one packet (including verifying the IPv4 checksum, and the TCP
+// checksum if the policy says to)
+void speed_test( const size_t payload_len,
+                 const bool split_headers,
+                 const ChecksumPolicy checksum = ChecksumPolicy::Verify )
+{
+  constexpr size_t batch_size = 10'000;
+  constexpr size_t rounds = 50;
+
+  const auto packet = make_packet( payload_len, split_headers );
+  vector<vector<string>> batch;
+  duration<double> parse_time {};
+  size_t payload_bytes = 0;
+
+  for ( size_t round = 0; round < rounds; ++round ) {
+    // The parsers take ownership of their buffers, so prepare fresh ones (outside the timed region)
+    batch.assign( batch_size, packet );
+
+    const auto start_time = steady_clock::now();
+    for ( auto& buffers : batch ) {
+      InternetDatagram dgram;
+      TCPSegment seg;
+      if ( not parse( dgram, move( buffers ) )
+           or not parse( seg, move( dgram.payload ), dgram.header.pseudo_checksum(), checksum ) ) {
+        throw runtime_error( "failed to parse packet" );
+      }
+      payload_bytes += seg.message.sender.payload.size();
+    }
+    parse_time += steady_clock::now() - start_time;
+  }
+
+  if ( payload_bytes != payload_len * batch_size * rounds ) {
+    throw runtime_error( "wrong payload length after parsing" );
+  }
+
+  const auto packets = static_cast<double>( batch_size * rounds );
+  const auto mpps = packets / parse_time.count() / 1e6;
+  const auto ns_per_packet = parse_time.count() * 1e9 / packets;
+
+  const string_view policy = checksum == ChecksumPolicy::Verify  ? ""
+                             : checksum == ChecksumPolicy::Defer ? " (TCP checksum deferred)"
+                                                                 : " (TCP checksum trusted)";
+  cout << "IPv4+TCP parse, " << setw( 4 ) << payload_len << "-byte payload, "
+       << ( split_headers ? "one buffer per header" : "one buffer per packet " ) << ": " << fixed
+       << setprecision( 2 ) << setw( 6 ) << mpps << " Mpackets/s, " << setw( 7 ) << ns_per_packet
+       << " ns/packet" << policy << "\n";
+}
+
+// Encapsulate a TCP message in an IPv4 datagram and serialize it, as the TUN adapter does for each write
+void serialize_speed_test( const size_t payload_len )
+{
+  constexpr size_t iterations = 500'000;
+
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "10.0.0.1", 1000 };
+  adapter.config_mut().destination = Address { "10.0.0.2", 2000 };
+
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { 12345 };
+  msg.sender.payload = string( payload_len, 'x' );
+  msg.receiver.ackno = Wrap32 { 67890 };
+  msg.receiver.window_size = 64000;
+
+  size_t bytes = 0;
+  size_t buffers = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < iterations; ++i ) {
+    const auto wire = serialize( adapter.wrap_tcp_in_ip( msg ) );
+    buffers += wire.size();
+    for ( const auto& buf : wire ) {
+      bytes += buf.size();
+    }
+  }
+  const duration<double> serialize_time = steady_clock::now() - start_time;
+
+  if ( bytes != ( IPv4Header::LENGTH + TCPSegment::HEADER_LENGTH + payload_len ) * iterations ) {
+    throw runtime_error( "wrong length after serializing" );
+  }
+
+  const auto ns_per_packet = serialize_time.count() * 1e9 / static_cast<double>( iterations );
+  cout << "IPv4+TCP serialize, " << setw( 4 ) << payload_len << "-byte payload: " << fixed << setprecision( 2 )
+       << setw( 6 ) << 1e3 / ns_per_packet << " Msegments/s, " << setw( 7 ) << ns_per_packet << " ns/packet, "
+       << static_cast<double>( buffers ) / static_cast<double>( iterations ) << " buffers/packet\n";
+}
+
+// Serialize many copies of one header back to back into a Serializer, then parse them all back out of the
+// result, to time the header codecs on their own (without a Parser or Serializer per header)
+template<class Header>
+void header_speed_test( const string_view name, const Header& header )
+{
+  constexpr size_t count = 1'000'000;
+
+  const auto serialize_start = steady_clock::now();
+  Serializer serializer { string {} };
+  for ( size_t i = 0; i < count; ++i ) {
+    header.serialize( serializer );
+  }
+  const auto wire = serializer.finish();
+  const duration<double> serialize_time = steady_clock::now() - serialize_start;
+
+  size_t bytes = 0;
+  for ( const auto& buf : wire ) {
+    bytes += buf.size();
+  }
+  if ( bytes != serialize( header ).front().size() * count ) {
+    throw runtime_error( "wrong length after serializing " + string( name ) + " headers" );
+  }
+
+  cout << setw( 8 ) << name << " header: " << fixed << setprecision( 2 ) << setw( 6 )
+       << serialize_time.count() * 1e9 / count << " ns/header serializing";
+
+  // (a TCPSegment takes the rest of its input as its payload, so its headers can't be parsed back to back)
+  if constexpr ( requires( Header h, Parser p ) { h.parse( p ); } ) {
+    Parser parser { wire };
+    Header parsed {};
+    const auto parse_start = steady_clock::now();
+    for ( size_t i = 0; i < count; ++i ) {
+      parsed.parse( parser );
+    }
+    const duration<double> parse_time = steady_clock::now() - parse_start;
+    if ( parser.has_error() or not parser.input().empty() ) {
+      throw runtime_error( "failed to parse " + string( name ) + " headers" );
+    }
+    cout << ", " << setw( 6 ) << parse_time.count() * 1e9 / count << " ns/header parsing";
+  }
+  cout << "\n";
+}
+
+void program_body()
+{
+  for ( const size_t payload_len : { 0, 1000 } ) {
+    for ( const bool split_headers : { true, false } ) {
+      speed_test( payload_len, split_headers );
+    }
+  }
+  speed_test( 1000, false, ChecksumPolicy::Defer );
+  speed_test( 1000, false, ChecksumPolicy::Trust );
+
+  for ( const size_t payload_len : { 0, 1000 } ) {
+    serialize_speed_test( payload_len );
+  }
+
+  EthernetHeader ethernet { { 2, 0, 0, 0, 0, 1 }, { 2, 0, 0, 0, 0, 2 }, EthernetHeader::TYPE_IPv4 };
+  header_speed_test( "Ethernet", ethernet );
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = ethernet.src;
+  arp.sender_ip_address = 0x0a000001;
+  arp.target_ethernet_address = ethernet.dst;
+  arp.target_ip_address = 0x0a000002;
+  header_speed_test( "ARP", arp );
+
+  IPv4Header ip;
+  ip.len = IPv4Header::LENGTH;
+  ip.src = 0x0a000001;
+  ip.dst = 0x0a000002;
+  ip.compute_checksum();
+  header_speed_test( "IPv4", ip );
+
+  TCPSegment tcp;
+  tcp.udinfo = { 1000, 2000, 0 };
+  tcp.message.sender.seqno = Wrap32 { 12345 };
+  tcp.message.sender.SYN = true;
+  tcp.message.receiver.ackno = Wrap32 { 67890 };
+  tcp.message.receiver.window_size = 64000;
+  header_speed_test( "TCP", tcp );
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,503 @@
+#include "address.hh"
+#include "fib.hh"
+#include "random.hh"
+#include "route_cache.hh"
+#include "route_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+using Route = RouteTable::Route;
+
+constexpr size_t full_table_size = 900'000; // about the size of the IPv4 Internet's routing table
+constexpr size_t lookup_count = 1 << 21;
+
+// The linear scan Router used before: every route is compared, and the longest (or last) match wins
+const Route* reference_lookup( const vector<Route>& routes, const uint32_t address )
+{
+  const Route* best = nullptr;
+  for ( const auto& route : routes ) {
+    const uint8_t length = route.prefix_length;
+    if ( ( length == 0 or address >> ( 32 - length ) == route.prefix >> ( 32 - length ) )
+         and ( not best or length >= best->prefix_length ) ) {
+      best = &route;
+    }
+  }
+  return best;
+}
+
+// Routes with prefix lengths distributed roughly as in the Internet's routing table (most of them /24s, some
+// shorter, a few longer), in unicast space
+vector<Route> make_routes( const size_t count, default_random_engine& rd )
+{
+  constexpr array<pair<uint8_t, unsigned>, 13> lengths { { { 8, 1 },
+                                                           { 12, 2 },
+                                                           { 16, 20 },
+                                                           { 18, 15 },
+                                                           { 19, 30 },
+                                                           { 20, 50 },
+                                                           { 21, 60 },
+                                                           { 22, 110 },
+                                                           { 23, 100 },
+                                                           { 24, 600 },
+                                                           { 26, 5 },
+                                                           { 28, 4 },
+                                                           { 32, 3 } } };
+  vector<unsigned> weights;
+  for ( const auto& [length, weight] : lengths ) {
+    weights.push_back( weight );
+  }
+  discrete_distribution<size_t> pick_length { weights.begin(), weights.end() };
+  uniform_int_distribution<uint32_t> pick_address { 0x01000000, 0xdfffffff };
+  uniform_int_distribution<size_t> pick_interface { 0, 7 };
+
+  vector<Route> routes;
+  routes.reserve( count );
+  for ( size_t i = 0; i < count; ++i ) {
+    const uint8_t length = lengths.at( pick_length( rd ) ).first;
+    const uint32_t prefix = pick_address( rd ) & ~( ( uint64_t { 1 } << ( 32 - length ) ) - 1 );
+    routes.push_back( { prefix, length, false, pick_address( rd ), pick_interface( rd ) } );
+  }
+  return routes;
+}
+
+// Destinations within the routes' prefixes (so that lookups reach the trie's deeper levels as often as a router's
+// would), and some anywhere at all
+vector<uint32_t> make_addresses( const vector<Route>& routes, const size_t count, default_random_engine& rd )
+{
+  uniform_int_distribution<size_t> pick_route { 0, routes.size() - 1 };
+  uniform_int_distribution<uint32_t> pick_address;
+  vector<uint32_t> addresses;
+  addresses.reserve( count );
+  for ( size_t i = 0; i < count; ++i ) {
+    const auto& route = routes[pick_route( rd )];
+    const uint32_t host_bits = route.prefix_length == 32 ? 0 : 0xffffffff >> route.prefix_length;
+    addresses.push_back( i % 4 == 0 ? pick_address( rd ) : route.prefix | ( pick_address( rd ) & host_bits ) );
+  }
+  return addresses;
+}
+
+RouteTable make_table( const vector<Route>& routes )
+{
+  RouteTable table;
+  for ( const auto& route : routes ) {
+    table.add( route );
+  }
+  return table;
+}
+
+bool same( const Route* a, const Route* b )
+{
+  if ( not a or not b ) {
+    return a == b;
+  }
+  return a->prefix == b->prefix and a->prefix_length == b->prefix_length and a->next_hop == b->next_hop
+         and a->interface_num == b->interface_num;
+}
+
+// The trie agrees with the linear scan, including on a default route and on repeated prefixes
+void check_against_reference( default_random_engine& rd )
+{
+  vector<Route> routes = make_routes( 2000, rd );
+  routes.push_back( { 0, 0, true, 0, 9 } );
+  for ( size_t i = 0; i < 200; ++i ) {
+    Route again = routes.at( i * 7 );
+    again.interface_num += 10;
+    routes.push_back( again );
+  }
+  const RouteTable table = make_table( routes );
+
+  // one at a time, and in a batch (of a length that leaves a partial group at the end)
+  const vector<uint32_t> addresses = make_addresses( routes, 100'003, rd );
+  vector<const Route*> batched( addresses.size() );
+  table.lookup( addresses, batched );
+  for ( size_t i = 0; i < addresses.size(); ++i ) {
+    const Route* expected = reference_lookup( routes, addresses[i] );
+    if ( not same( table.lookup( addresses[i] ), expected ) or not same( batched[i], expected ) ) {
+      throw runtime_error( "RouteTable disagrees with the linear scan on "
+                           + Address::from_ipv4_numeric( addresses[i] ).ip() );
+    }
+  }
+}
+
+const Route* cached_lookup( RouteCache& cache, const RouteTable& table, const uint32_t address )
+{
+  const Route* route = nullptr;
+  if ( not cache.find( address, route ) ) {
+    route = table.lookup( address );
+    cache.insert( address, route );
+  }
+  return route;
+}
+
+// Routes found through a RouteCache are the table's, including after the table changes (and the cache is
+// invalidated)
+void check_cache( default_random_engine& rd )
+{
+  vector<Route> routes = make_routes( 2000, rd );
+  RouteTable table = make_table( routes );
+  RouteCache cache;
+  vector<uint32_t> addresses = make_addresses( routes, 256, rd );
+
+  for ( size_t round = 0; round < 3; ++round ) {
+    for ( size_t i = 0; i < 20 * addresses.size(); ++i ) {
+      const uint32_t address = addresses[i % addresses.size()];
+      if ( not same( cached_lookup( cache, table, address ), reference_lookup( routes, address ) ) ) {
+        throw runtime_error( "RouteCache gave a stale route for " + Address::from_ipv4_numeric( address ).ip() );
+      }
+    }
+
+    // a more specific route for every other destination
+    for ( size_t i = 0; i < addresses.size(); i += 2 ) {
+      routes.push_back( { addresses[i], 32, false, addresses[i], 100 + round } );
+      table.add( routes.back() );
+    }
+    cache.invalidate();
+  }
+  if ( cache.stats().hits == 0 ) {
+    throw runtime_error( "RouteCache never hit" );
+  }
+}
+
+// A Fib's versions are each as they were published: a reader still using an old one sees none of the changes
+// since, and the old versions are freed once it quiesces
+void check_fib( default_random_engine& rd )
+{
+  vector<Route> routes = make_routes( 2000, rd );
+  const vector<uint32_t> addresses = make_addresses( routes, 10'000, rd );
+  Fib fib;
+  fib.update( [&]( RouteTable& table ) {
+    for ( const auto& route : routes ) {
+      table.add( route );
+    }
+  } );
+  auto reader = fib.reader();
+  reader.online();
+  const Fib::Version& old = reader.current();
+  const vector<Route> old_routes = routes;
+
+  for ( size_t i = 0; i < addresses.size(); i += 3 ) {
+    const auto length = static_cast<uint8_t>( 24 + i % 9 );
+    const uint32_t prefix = addresses[i] & ~( ( uint64_t { 1 } << ( 32 - length ) ) - 1 );
+    routes.push_back( { prefix, length, false, addresses[i], 100 } );
+    fib.update( [&]( RouteTable& table ) { table.add( routes.back() ); } );
+  }
+  for ( const uint32_t address : addresses ) {
+    if ( not same( old.table.lookup( address ), reference_lookup( old_routes, address ) )
+         or not same( reader.current().table.lookup( address ), reference_lookup( routes, address ) ) ) {
+      throw runtime_error( "Fib version disagrees with the linear scan on "
+                           + Address::from_ipv4_numeric( address ).ip() );
+    }
+  }
+
+  if ( fib.stats().retired == 0 ) {
+    throw runtime_error( "Fib reclaimed a version still in use" );
+  }
+  reader.quiescent();
+  fib.reclaim();
+  if ( fib.stats().retired != 0 ) {
+    throw runtime_error( "Fib kept " + to_string( fib.stats().retired ) + " versions after its reader quiesced" );
+  }
+}
+
+template<class Lookup>
+double lookups_per_second( const vector<uint32_t>& addresses, const size_t count, Lookup&& lookup )
+{
+  size_t sink = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < count; ++i ) {
+    const Route* route = lookup( addresses[i & ( addresses.size() - 1 )] ); // (a power of two long)
+    sink += route ? route->interface_num : 0;
+  }
+  const auto elapsed = duration_cast<duration<double>>( steady_clock::now() - start_time );
+  if ( sink == 1 ) {
+    cout << " ";
+  }
+  return static_cast<double>( count ) / elapsed.count();
+}
+
+// A routing table for the benchmarks (built once, and shared by all those on the full table), with its routes
+struct BuiltTable
+{
+  vector<Route> routes;
+  RouteTable table;
+  double build_seconds;
+};
+
+BuiltTable build_table( const size_t table_size, default_random_engine& rd )
+{
+  vector<Route> routes = make_routes( table_size, rd );
+  const auto build_start = steady_clock::now();
+  RouteTable table = make_table( routes );
+  const auto build_time = duration_cast<duration<double>>( steady_clock::now() - build_start );
+  return { move( routes ), move( table ), build_time.count() };
+}
+
+void speed_test( const BuiltTable& built, const bool with_reference, default_random_engine& rd )
+{
+  const auto& [routes, table, build_seconds] = built;
+  const vector<uint32_t> addresses = make_addresses( routes, 1 << 20, rd );
+
+  cout << fixed << setprecision( 1 ) << "Routing table of " << setw( 6 ) << routes.size() << " prefixes: "
+       << setw( 6 ) << lookups_per_second( addresses, lookup_count, [&]( const uint32_t a ) {
+            return table.lookup( a );
+          } ) / 1e6
+       << " M lookups/s, " << setw( 6 ) << static_cast<double>( table.memory_footprint() ) / ( 1 << 20 )
+       << " MiB, built in " << setprecision( 3 ) << build_seconds << " s";
+  if ( with_reference ) {
+    cout << " (linear scan: " << setprecision( 3 )
+         << lookups_per_second( addresses, 20'000, [&]( const uint32_t a ) {
+              return reference_lookup( routes, a );
+            } ) / 1e6
+         << " M lookups/s)";
+  }
+  cout << "\n";
+}
+
+// Batched lookups on the full table, by batch size
+void batch_test( const BuiltTable& full, default_random_engine& rd )
+{
+  const auto& [routes, table, build_seconds] = full;
+  const vector<uint32_t> addresses = make_addresses( routes, 1 << 20, rd );
+  vector<const Route*> results( addresses.size() );
+
+  cout << "Batched lookups among " << full_table_size << " prefixes:\n";
+  for ( const size_t batch_size : { 1, 2, 4, 8, 16, 32, 64, 256 } ) {
+    size_t sink = 0;
+    const auto start_time = steady_clock::now();
+    for ( size_t first = 0; first < lookup_count; first += batch_size ) {
+      const size_t offset = first & ( addresses.size() - 1 );
+      table.lookup( span { addresses }.subspan( offset, batch_size ), span { results }.subspan( 0, batch_size ) );
+      sink += results.front() ? results.front()->interface_num : 0;
+    }
+    const auto elapsed = duration_cast<duration<double>>( steady_clock::now() - start_time );
+    if ( sink == 1 ) {
+      cout << " ";
+    }
+    cout << "   batch of " << setw( 3 ) << batch_size << ": " << fixed << setprecision( 1 ) << setw( 6 )
+         << static_cast<double>( lookup_count ) / elapsed.count() / 1e6 << " M lookups/s\n";
+  }
+}
+
+// Traffic that mostly goes to a few hot destinations (90% of it to `hot_count` of them), on the full table, looked
+// up in bursts of 64 as Router does: in the table alone, and through a RouteCache that looks up its misses together
+// (as Router does when constructed with its cache on)
+void cache_test( const BuiltTable& full, default_random_engine& rd, const size_t hot_count )
+{
+  const auto& [routes, table, build_seconds] = full;
+  const vector<uint32_t> hot = make_addresses( routes, hot_count, rd );
+  vector<uint32_t> addresses = make_addresses( routes, 1 << 20, rd );
+  uniform_int_distribution<size_t> pick_hot { 0, hot.size() - 1 };
+  for ( size_t i = 0; i < addresses.size(); ++i ) {
+    if ( i % 10 ) {
+      addresses[i] = hot[pick_hot( rd )];
+    }
+  }
+
+  constexpr size_t burst_size = 64;
+  vector<const Route*> results( burst_size );
+  const auto lookups_per_second_in_bursts = [&]( const auto& lookup_burst ) {
+    size_t sink = 0;
+    const auto start_time = steady_clock::now();
+    for ( size_t first = 0; first < lookup_count; first += burst_size ) {
+      lookup_burst( span { addresses }.subspan( first & ( addresses.size() - 1 ), burst_size ) );
+      sink += results.front() ? results.front()->interface_num : 0;
+    }
+    const auto elapsed = duration_cast<duration<double>>( steady_clock::now() - start_time );
+    if ( sink == 1 ) {
+      cout << " ";
+    }
+    return static_cast<double>( lookup_count ) / elapsed.count();
+  };
+
+  const double uncached = lookups_per_second_in_bursts( [&]( const span<const uint32_t> burst ) {
+    table.lookup( burst, results );
+  } );
+
+  RouteCache cache;
+  vector<uint32_t> miss_addresses;
+  vector<size_t> miss_index;
+  vector<const Route*> miss_routes;
+  const double cached = lookups_per_second_in_bursts( [&]( const span<const uint32_t> burst ) {
+    miss_addresses.clear();
+    miss_index.clear();
+    for ( size_t i = 0; i < burst.size(); ++i ) {
+      if ( not cache.find( burst[i], results[i] ) ) {
+        miss_addresses.push_back( burst[i] );
+        miss_index.push_back( i );
+      }
+    }
+    miss_routes.resize( miss_addresses.size() );
+    table.lookup( miss_addresses, miss_routes );
+    for ( size_t j = 0; j < miss_addresses.size(); ++j ) {
+      results[miss_index[j]] = miss_routes[j];
+      cache.insert( miss_addresses[j], miss_routes[j] );
+    }
+  } );
+
+  const auto& stats = cache.stats();
+  const double hit_rate = static_cast<double>( stats.hits ) / static_cast<double>( stats.hits + stats.misses );
+  cout << fixed << setprecision( 1 ) << "90% of traffic to " << setw( 4 ) << hot_count
+       << " destinations, in bursts of 64: " << setw( 6 ) << uncached / 1e6 << " M lookups/s in the table, "
+       << setw( 6 ) << cached / 1e6 << " M lookups/s through the cache (" << 100 * hit_rate << "% hits)\n";
+}
+
+double thread_cpu_seconds()
+{
+  timespec ts {};
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+  return static_cast<double>( ts.tv_sec ) + static_cast<double>( ts.tv_nsec ) / 1e9;
+}
+
+// `count` random /24 routes
+vector<Route> make_updates( const size_t count, default_random_engine& rd )
+{
+  uniform_int_distribution<uint32_t> pick_address { 0x01000000, 0xdfffffff };
+  vector<Route> updates;
+  for ( size_t i = 0; i < count; ++i ) {
+    updates.push_back( { pick_address( rd ) & 0xffffff00, 24, false, pick_address( rd ), 1 } );
+  }
+  return updates;
+}
+
+// Batched lookups on the full table in a Fib (quiescing between batches), while another thread changes
+// `update_rate` /24 routes per second, publishing a new version for every `routes_per_version` of them
+void churn_test( default_random_engine& rd,
+                 const RouteTable& full,
+                 const vector<uint32_t>& addresses,
+                 const unsigned update_rate,
+                 const unsigned routes_per_version )
+{
+  Fib fib;
+  fib.update( [&]( RouteTable& table ) { table = full; } );
+
+  atomic<bool> done = false;
+  thread updater { [&, seed = rd()] {
+    default_random_engine update_rd { seed };
+    for ( auto next = steady_clock::now(); update_rate > 0 and not done; ) {
+      const vector<Route> routes = make_updates( routes_per_version, update_rd );
+      fib.update( [&]( RouteTable& table ) {
+        for ( const auto& route : routes ) {
+          table.add( route );
+        }
+      } );
+      next += nanoseconds { 1'000'000'000ULL * routes_per_version / update_rate };
+      this_thread::sleep_until( next );
+    }
+  } };
+
+  constexpr size_t batch_size = 64;
+  constexpr auto run_time = milliseconds { 500 };
+  array<const Route*, batch_size> results {};
+  size_t lookups = 0;
+  size_t sink = 0;
+  auto reader = fib.reader();
+  reader.online();
+  const uint64_t first_version = reader.current().number;
+  const double start_cpu = thread_cpu_seconds();
+  const auto start_time = steady_clock::now();
+  while ( steady_clock::now() - start_time < run_time ) {
+    for ( size_t i = 0; i < 256; ++i, lookups += batch_size ) {
+      const size_t offset = lookups & ( addresses.size() - 1 );
+      reader.current().table.lookup( span { addresses }.subspan( offset, batch_size ), results );
+      sink += results.front() ? results.front()->interface_num : 0;
+      reader.quiescent();
+    }
+  }
+  const auto elapsed = duration_cast<duration<double>>( steady_clock::now() - start_time );
+  const double cpu = thread_cpu_seconds() - start_cpu;
+  const uint64_t versions = reader.current().number - first_version;
+  reader.offline();
+  done = true;
+  updater.join();
+  if ( sink == 1 ) {
+    cout << " ";
+  }
+
+  const auto stats = fib.stats();
+  cout << fixed << setprecision( 1 ) << "   " << setw( 5 ) << update_rate << " updates/s, " << setw( 3 )
+       << routes_per_version << " per version: " << setw( 6 )
+       << static_cast<double>( lookups ) / elapsed.count() / 1e6 << " M lookups/s (" << setw( 6 )
+       << static_cast<double>( lookups ) / cpu / 1e6 << " M per second of the reader's CPU time), "
+       << setprecision( 0 ) << setw( 5 ) << static_cast<double>( versions ) / elapsed.count()
+       << " versions/s seen, " << stats.reclaimed << " of " << stats.published << " reclaimed\n";
+}
+
+void churn_tests( const BuiltTable& built, default_random_engine& rd )
+{
+  const RouteTable& full = built.table;
+  const vector<uint32_t> addresses = make_addresses( built.routes, 1 << 20, rd );
+
+  // what each version costs to make (and free), by how many routes it changes
+  cout << "Updating " << full_table_size << " prefixes copy-on-write:\n";
+  for ( const size_t routes_per_version : { 1, 16, 256 } ) {
+    constexpr size_t version_count = 500;
+    const vector<Route> updates = make_updates( version_count * routes_per_version, rd );
+    const auto update_start = steady_clock::now();
+    for ( size_t i = 0; i < version_count; ++i ) {
+      RouteTable copy = full;
+      for ( size_t j = 0; j < routes_per_version; ++j ) {
+        copy.add( updates[i * routes_per_version + j] );
+      }
+    }
+    const auto update_time = duration_cast<duration<double, micro>>( steady_clock::now() - update_start );
+    cout << "   " << setw( 3 ) << routes_per_version << " route" << ( routes_per_version == 1 ? " " : "s" )
+         << " per version: " << fixed << setprecision( 1 ) << setw( 6 ) << update_time.count() / version_count
+         << " us per version, " << setw( 5 )
+         << update_time.count() / static_cast<double>( version_count * routes_per_version ) << " us per route\n";
+  }
+
+  cout << "Batched lookups among " << full_table_size << " prefixes in a Fib, under churn:\n";
+  constexpr array<pair<unsigned, unsigned>, 4> runs { { { 0, 1 }, { 1000, 1 }, { 5000, 1 }, { 20'000, 100 } } };
+  for ( const auto& [update_rate, routes_per_version] : runs ) {
+    churn_test( rd, full, addresses, update_rate, routes_per_version );
+  }
+}
+
+void program_body()
+{
+  auto rd = get_random_engine();
+  check_against_reference( rd );
+  check_cache( rd );
+  check_fib( rd );
+  speed_test( build_table( 10'000, rd ), true, rd );
+  const BuiltTable full = build_table( full_table_size, rd );
+  speed_test( full, false, rd );
+  batch_test( full, rd );
+  cache_test( full, rd, 16 );
+  cache_test( full, rd, 256 );
+  cache_test( full, rd, 4096 );
+  churn_tests( full, rd );
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -3,8 +3,10 @@
 #include "network_interface_test_harness.hh"
 #include "random.hh"
 
+#include <array>
 #include <iostream>
 #include <list>
+#include <span>
 #include <unordered_map>
 #include <utility>
 
@@ -57,6 +59,21 @@ public:
     } );
   }
 
+  void transmit_batch( const NetworkInterface& sender, span<const EthernetFrame> frames ) override
+  {
+    ranges::for_each( connections_, [&]( auto& weak_ref ) {
+      const shared_ptr<NetworkInterface> interface( weak_ref );
+      if ( &sender != interface.get() ) {
+        for ( const auto& frame : frames ) {
+          cerr << "Transferring frame from " << sender.name() << " to " << interface->name() << " (in a batch of "
+               << frames.size() << "): " << summary( frame ) << "\n";
+        }
+        vector<EthernetFrame> copies { frames.begin(), frames.end() };
+        interface->recv_frames( copies );
+      }
+    } );
+  }
+
   void connect( const shared_ptr<NetworkInterface>& interface ) { connections_.push_back( interface ); }
 };
 
@@ -330,10 +347,127 @@ void network_simulator()
   cout << "\n\n\033[32;1mCongratulations! All datagrams were routed successfully.\033[m\n";
 }
 
+// With its route cache on, a router forwards by routes added after a destination's route (or lack of one) was
+// cached
+void cached_routes_test()
+{
+  const string green = "\033[32;1m";
+  const string normal = "\033[m";
+
+  cerr << green << "\n\nConstructing a router with its route cache on." << normal << "\n";
+
+  Router router { true };
+  const auto local = make_shared<NetworkSegment>();
+  const auto lan = make_shared<NetworkSegment>();
+  const size_t local_id = router.add_interface(
+    make_shared<NetworkInterface>( "eth0", local, random_router_ethernet_address(), Address { "10.0.0.1" } ) );
+  const size_t lan_id = router.add_interface(
+    make_shared<NetworkInterface>( "eth1", lan, random_router_ethernet_address(), Address { "192.168.0.1" } ) );
+
+  Host sender { "sender", Address { "10.0.0.2" }, Address { "10.0.0.1" }, local };
+  Host lan_host { "lan_host", Address { "192.168.0.2" }, Address { "192.168.0.1" }, lan };
+  Host gateway { "gateway", Address { "192.168.0.254" }, Address { "192.168.0.1" }, lan };
+  local->connect( router.interface( local_id ) );
+  local->connect( sender.interface() );
+  lan->connect( router.interface( lan_id ) );
+  lan->connect( lan_host.interface() );
+  lan->connect( gateway.interface() );
+
+  router.add_route( ip( "10.0.0.0" ), 8, {}, local_id );
+  router.add_route( ip( "192.168.0.0" ), 16, gateway.address(), lan_id );
+
+  const auto send = [&]( const Address& destination, Host* receiver ) {
+    auto dgram_sent = sender.send_to( destination );
+    dgram_sent.header.ttl--;
+    dgram_sent.header.compute_checksum();
+    if ( receiver ) {
+      receiver->expect( dgram_sent );
+    }
+    for ( unsigned int i = 0; i < 16; i++ ) {
+      router.route();
+    }
+    for ( Host* host : { &sender, &lan_host, &gateway } ) {
+      host->check();
+    }
+  };
+
+  cout << green << "\n\nTesting a more specific route added after the destination's route was cached..." << normal
+       << "\n\n";
+  send( lan_host.address(), &gateway );
+  send( lan_host.address(), &gateway );
+  router.add_route( ip( "192.168.0.0" ), 24, {}, lan_id );
+  send( lan_host.address(), &lan_host );
+
+  cout << green << "\n\nSuccess! Testing a route added after the destination was cached as having none..." << normal
+       << "\n\n";
+  send( Address { "172.16.0.5" }, nullptr );
+  send( Address { "172.16.0.5" }, nullptr );
+  router.add_route( ip( "172.16.0.0" ), 12, gateway.address(), lan_id );
+  send( Address { "172.16.0.5" }, &gateway );
+
+  if ( router.route_cache_stats().hits == 0 ) {
+    throw runtime_error( "the router never found a route in its cache" );
+  }
+
+  cout << "\n\n\033[32;1mCongratulations! The cached routes kept up with the table.\033[m\n";
+}
+
+// An output port that fails
+class BrokenPort : public NetworkInterface::OutputPort
+{
+public:
+  void transmit( const NetworkInterface& sender [[maybe_unused]],
+                 const EthernetFrame& frame [[maybe_unused]] ) override
+  {
+    throw runtime_error( "broken port" );
+  }
+};
+
+// A router whose route() is interrupted by an exception doesn't hold on to the table's old versions
+void route_exception_test()
+{
+  cerr << "\033[32;1m\n\nTesting an output port that throws...\033[m\n";
+
+  Router router;
+  const auto local = make_shared<NetworkSegment>();
+  const size_t local_id = router.add_interface(
+    make_shared<NetworkInterface>( "eth0", local, random_router_ethernet_address(), Address { "10.0.0.1" } ) );
+  const size_t broken_id = router.add_interface( make_shared<NetworkInterface>(
+    "eth1", make_shared<BrokenPort>(), random_router_ethernet_address(), Address { "192.168.0.1" } ) );
+  Host sender { "sender", Address { "10.0.0.2" }, Address { "10.0.0.1" }, local };
+  local->connect( router.interface( local_id ) );
+  local->connect( sender.interface() );
+  router.add_route( ip( "192.168.0.0" ), 16, {}, broken_id );
+
+  sender.send_to( Address { "192.168.0.2" } );
+  bool threw = false;
+  try {
+    router.route();
+  } catch ( const runtime_error& ) {
+    threw = true;
+  }
+  if ( not threw ) {
+    throw runtime_error( "the broken port's exception didn't reach route()'s caller" );
+  }
+
+  const uint64_t published = router.fib().stats().published;
+  const array<RouteTable::Route, 2> routes { { { ip( "172.16.0.0" ), 12, true, 0, broken_id },
+                                               { ip( "172.32.0.0" ), 12, true, 0, broken_id } } };
+  router.add_routes( routes );
+  if ( router.fib().stats().published != published + 1 ) {
+    throw runtime_error( "add_routes() should publish its routes in one version of the table" );
+  }
+  if ( router.fib().stats().retired != 0 ) {
+    throw runtime_error( "the router stayed online in its FIB after route() threw, holding on to old versions" );
+  }
+}
+
 int main()
 {
   try {
     network_simulator();
+    cached_routes_test();
+    route_exception_test();
   } catch ( const exception& e ) {
     cerr << "\n\n\n";
     cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
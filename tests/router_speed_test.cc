@@ -0,0 +1,177 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "network_interface.hh"
+#include "router.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t interface_count = 4;
+constexpr size_t packet_count = 2'000'000;
+
+// Counts the frames the router sends, and the calls to the port it takes to send them
+class CountingPort : public NetworkInterface::OutputPort
+{
+public:
+  size_t frames {};
+  size_t calls {};
+
+  void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x [[maybe_unused]] ) override
+  {
+    ++frames;
+    ++calls;
+  }
+
+  void transmit_batch( const NetworkInterface& n [[maybe_unused]], span<const EthernetFrame> x ) override
+  {
+    frames += x.size();
+    ++calls;
+  }
+};
+
+EthernetAddress router_mac( const size_t i )
+{
+  return { 0x02, 0, 0, 0, 1, static_cast<uint8_t>( i ) };
+}
+
+EthernetAddress host_mac( const size_t i )
+{
+  return { 0x02, 0, 0, 0, 2, static_cast<uint8_t>( i ) };
+}
+
+uint32_t router_ip( const size_t i )
+{
+  return 0x0a000001 + static_cast<uint32_t>( i << 8 ); // 10.0.i.1
+}
+
+uint32_t host_ip( const size_t i )
+{
+  return 0x0a000002 + static_cast<uint32_t>( i << 8 ); // 10.0.i.2
+}
+
+// A router with one host on each of its interfaces, as in tests/router.cc, that has already learned the hosts'
+// Ethernet addresses
+struct Topology
+{
+  Router router {};
+  shared_ptr<CountingPort> port { make_shared<CountingPort>() };
+
+  Topology()
+  {
+    for ( size_t i = 0; i < interface_count; ++i ) {
+      router.add_interface( make_shared<NetworkInterface>(
+        "eth" + to_string( i ), port, router_mac( i ), Address::from_ipv4_numeric( router_ip( i ) ) ) );
+      router.add_route( router_ip( i ) & 0xffffff00, 24, {}, i );
+
+      ARPMessage reply;
+      reply.opcode = ARPMessage::OPCODE_REPLY;
+      reply.sender_ethernet_address = host_mac( i );
+      reply.sender_ip_address = host_ip( i );
+      reply.target_ethernet_address = router_mac( i );
+      reply.target_ip_address = router_ip( i );
+      router.interface( i )->recv_frame(
+        EthernetFrame { { router_mac( i ), host_mac( i ), EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+    }
+    port->frames = port->calls = 0;
+  }
+};
+
+// Bursts of datagrams arriving on each interface, from its host to the next interface's host
+vector<vector<string>> make_bursts( const size_t burst_size )
+{
+  vector<vector<string>> bursts( interface_count );
+  for ( size_t i = 0; i < interface_count; ++i ) {
+    for ( size_t j = 0; j < burst_size; ++j ) {
+      InternetDatagram dgram;
+      dgram.header.src = host_ip( i );
+      dgram.header.dst = host_ip( ( i + 1 ) % interface_count );
+      dgram.header.id = static_cast<uint16_t>( j );
+      dgram.payload.emplace_back( string( 64, 'x' ) );
+      dgram.header.len = static_cast<uint16_t>( dgram.header.hlen * 4 + 64 );
+      dgram.header.compute_checksum();
+      string& wire = bursts[i].emplace_back();
+      for ( const auto& buffer : serialize( dgram ) ) {
+        wire.append( buffer.view() );
+      }
+    }
+  }
+  return bursts;
+}
+
+void speed_test( const string_view name, const bool batched, const size_t burst_size )
+{
+  Topology topology;
+  const auto bursts = make_bursts( burst_size );
+  vector<EthernetFrame> frames;
+
+  const size_t rounds = packet_count / ( interface_count * burst_size );
+  const auto start_copies = Buffer::copy_stats();
+  const auto start_time = steady_clock::now();
+  for ( size_t round = 0; round < rounds; ++round ) {
+    for ( size_t i = 0; i < interface_count; ++i ) {
+      auto& interface = *topology.router.interface( i );
+      // each frame arrives in bytes of its own, as from a NIC
+      frames.clear();
+      for ( const auto& wire : bursts[i] ) {
+        frames.push_back( { { router_mac( i ), host_mac( i ), EthernetHeader::TYPE_IPv4 }, { string { wire } } } );
+      }
+      if ( batched ) {
+        interface.recv_frames( frames );
+        topology.router.route();
+      } else {
+        for ( auto& frame : frames ) {
+          interface.recv_frame( std::move( frame ) );
+          topology.router.route();
+        }
+      }
+    }
+  }
+  const auto elapsed = duration_cast<duration<double, nano>>( steady_clock::now() - start_time );
+  const auto bytes_copied = Buffer::copy_stats().bytes - start_copies.bytes;
+
+  const size_t packets = rounds * interface_count * burst_size;
+  if ( topology.port->frames != packets ) {
+    throw runtime_error( "router forwarded " + to_string( topology.port->frames ) + " frames, expected "
+                         + to_string( packets ) );
+  }
+
+  const auto per_packet = [&]( const auto n ) { return static_cast<double>( n ) / static_cast<double>( packets ); };
+  cout << "Router forwarding " << name << ": " << fixed << setprecision( 2 ) << setw( 7 )
+       << per_packet( elapsed.count() ) << " ns/packet, " << setw( 6 ) << per_packet( topology.port->calls )
+       << " port calls/packet, " << setw( 6 ) << per_packet( bytes_copied ) << " bytes copied/packet\n";
+}
+
+void program_body()
+{
+  speed_test( "one frame at a time", false, 32 );
+  for ( const size_t burst_size : { 4, 16, 32, 64 } ) {
+    speed_test( "in bursts of " + to_string( burst_size ), true, burst_size );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
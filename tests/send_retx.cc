@@ -1,6 +1,7 @@
 #include "random.hh"
 #include "sender_test_harness.hh"
 
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <exception>
@@ -10,6 +11,7 @@
 #include <string>
 
 using namespace std;
+using namespace std::chrono_literals;
 
 int main()
 {
@@ -48,6 +50,58 @@ int main()
       test.execute( HasError { false } );
     }
 
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const auto retx_timeout = chrono::microseconds { uniform_int_distribution<int64_t> { 20, 999 }( rd ) };
+      cfg.isn = isn;
+      cfg.rt_timeout_us = retx_timeout;
+
+      TCPSenderTestHarness test { "Retx SYN at a sub-millisecond RTO", cfg };
+      test.execute( ExpectNextTimeout { nullopt } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( ExpectNextTimeout { retx_timeout } );
+      test.execute( Tick { retx_timeout - 1us } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectNextTimeout { 1us } );
+      test.execute( Tick { 1us } );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( ExpectNextTimeout { 2 * retx_timeout } );
+      test.execute( Tick { 2 * retx_timeout - 1us } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1us } );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( ExpectNextTimeout { nullopt } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> { 10, 10000 }( rd );
+      cfg.isn = isn;
+      cfg.rt_timeout = retx_timeout;
+
+      TCPSenderTestHarness test { "Data pushed after an idle period waits a full RTO before retx", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectNextTimeout { nullopt } );
+      // (with nothing in flight, the time that passes while idle doesn't count against the next segment)
+      test.execute( Tick { 10U * retx_timeout } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_payload_size( 3 ).with_data( "abc" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNextTimeout { chrono::milliseconds { retx_timeout } } );
+      test.execute( Tick { retx_timeout - 1U } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( 3 ).with_data( "abc" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
     {
       TCPConfig cfg;
       const Wrap32 isn( rd() );
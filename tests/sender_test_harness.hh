@@ -7,6 +7,7 @@
 #include "tcp_sender.hh"
 #include "wrapping_integers.hh"
 
+#include <chrono>
 #include <optional>
 #include <queue>
 #include <sstream>
@@ -80,6 +81,28 @@ struct ExpectConsecutiveRetransmissions : public ExpectNumber<SenderAndOutput, u
   uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.consecutive_retransmissions(); }
 };
 
+struct ExpectNextTimeout : public Expectation<SenderAndOutput>
+{
+  std::optional<std::chrono::microseconds> timeout_;
+
+  explicit ExpectNextTimeout( std::optional<std::chrono::microseconds> timeout ) : timeout_( timeout ) {}
+  std::string description() const override
+  {
+    return timeout_.has_value() ? "next_timeout = " + std::to_string( timeout_->count() ) + " us"
+                                : "no timer running";
+  }
+  void execute( SenderAndOutput& ss ) const override
+  {
+    const auto actual = ss.sender.next_timeout();
+    if ( actual != timeout_ ) {
+      throw ExpectationViolation { "TCPSender::next_timeout() returned "
+                                   + ( actual.has_value() ? std::to_string( actual->count() ) + " us"
+                                                          : std::string { "no timer" } )
+                                   + ", but expected " + description() };
+    }
+  }
+};
+
 struct ExpectNoSegment : public Expectation<SenderAndOutput>
 {
   std::string description() const override { return "nothing to send"; }
@@ -143,10 +166,11 @@ struct Push : public Action<SenderAndOutput>
 
 struct Tick : public Action<SenderAndOutput>
 {
-  uint64_t ms_;
+  std::chrono::microseconds time_;
   std::optional<bool> max_retx_exceeded_ {};
 
-  explicit Tick( uint64_t ms ) : ms_( ms ) {}
+  explicit Tick( uint64_t ms ) : time_( std::chrono::milliseconds { ms } ) {}
+  explicit Tick( std::chrono::microseconds time ) : time_( time ) {}
 
   Tick& with_max_retx_exceeded( bool val )
   {
@@ -157,7 +181,7 @@ struct Tick : public Action<SenderAndOutput>
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << ms_ << " ms pass";
+    desc << duration_str() << " pass";
     if ( max_retx_exceeded_.has_value() ) {
       desc << " with max_retx_exceeded = " << max_retx_exceeded_.value();
     }
@@ -166,11 +190,11 @@ struct Tick : public Action<SenderAndOutput>
 
   void execute( SenderAndOutput& ss ) const override
   {
-    ss.sender.tick( ms_, ss.make_transmit() );
+    ss.sender.tick( time_, ss.make_transmit() );
     if ( max_retx_exceeded_.has_value()
          and max_retx_exceeded_ != ( ss.sender.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS ) ) {
       std::ostringstream desc;
-      desc << "after " << ms_ << " ms passed the TCP Sender reported\n\tconsecutive_retransmissions = "
+      desc << "after " << duration_str() << " passed the TCP Sender reported\n\tconsecutive_retransmissions = "
            << ss.sender.consecutive_retransmissions() << "\nbut it should have been\n\t";
       if ( max_retx_exceeded_.value() ) {
         desc << "greater than ";
@@ -181,6 +205,14 @@ struct Tick : public Action<SenderAndOutput>
       throw ExpectationViolation( desc.str() );
     }
   }
+
+  std::string duration_str() const
+  {
+    if ( time_ % std::chrono::milliseconds { 1 } == std::chrono::microseconds::zero() ) {
+      return std::to_string( std::chrono::duration_cast<std::chrono::milliseconds>( time_ ).count() ) + " ms";
+    }
+    return std::to_string( time_.count() ) + " us";
+  }
 };
 
 struct Receive : public Action<SenderAndOutput>
@@ -358,7 +390,7 @@ class TCPSenderTestHarness : public TestHarness<SenderAndOutput>
 public:
   TCPSenderTestHarness( std::string name, TCPConfig config )
     : TestHarness( move( name ),
-                   "initial_RTO_ms=" + to_string( config.rt_timeout ),
-                   { TCPSender { ByteStream { config.send_capacity }, config.isn, config.rt_timeout } } )
+                   "initial_RTO_us=" + to_string( config.initial_RTO().count() ),
+                   { TCPSender { ByteStream { config.send_capacity }, config.isn, config.initial_RTO() } } )
   {}
 };
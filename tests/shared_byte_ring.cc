@@ -0,0 +1,276 @@
+#include "common.hh"
+#include "shared_byte_ring.hh"
+#include "tcp_config.hh"
+#include "tcp_minnow_socket.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+namespace {
+bool readable( FileDescriptor& fd )
+{
+  pollfd pfd { fd.fd_num(), POLLIN, 0 };
+  return ::poll( &pfd, 1, 0 ) == 1 and ( pfd.revents & POLLIN );
+}
+
+// Bytes pushed past the end of the buffer continue from its start, and are peeked at in two pieces
+void check_wrap_around()
+{
+  SharedByteRing ring { 8 };
+  expect( ring.push( "abcdef" ) == 6, "push into an empty ring fell short" );
+  expect( ring.peek() == "abcdef", "peek didn't show what was pushed" );
+  ring.pop( 4 );
+
+  expect( ring.writable_region().size() == 2, "the writable region should end at the end of the buffer" );
+  expect( ring.push( "ghijklmn" ) == 6, "push straddling the end didn't fill the ring" );
+  expect( ring.bytes_buffered() == 8 and ring.available_capacity() == 0, "ring should be full" );
+  expect( ring.push( "o" ) == 0, "push into a full ring" );
+
+  expect( ring.peek() == "efgh", "peek should stop at the end of the buffer" );
+  ring.pop( 4 );
+  expect( ring.peek() == "ijkl", "peek after wrapping around" );
+  ring.pop( 3 );
+  expect( ring.peek() == "l", "peek of a partly popped piece" );
+
+  // writing in place, across the end
+  auto region = ring.writable_region();
+  expect( region.size() == 4, "the writable region should run to the end of the buffer" );
+  string_view( "wxyz" ).copy( region.data(), 4 );
+  ring.commit( 4 );
+  region = ring.writable_region();
+  expect( region.size() == 3, "the writable region should continue from the start" );
+  region[0] = '!';
+  ring.commit( 1 );
+  expect( ring.peek() == "lwxyz", "bytes committed in place" );
+  ring.pop( 5 );
+  expect( ring.peek() == "!", "bytes committed in place after wrapping around" );
+
+  bool threw = false;
+  try {
+    ring.pop( 2 );
+  } catch ( const runtime_error& ) {
+    threw = true;
+  }
+  expect( threw, "pop of more than was buffered should throw" );
+}
+
+// The fds say whether there is data or room, across the transitions between empty, full and neither
+void check_notifications()
+{
+  SharedByteRing ring { 4 };
+  expect( readable( ring.space_fd() ) and not readable( ring.data_fd() ), "a new ring has room and no data" );
+
+  ring.push( "ab" );
+  expect( readable( ring.space_fd() ) and readable( ring.data_fd() ), "a ring partly full has room and data" );
+  ring.push( "cd" );
+  expect( not readable( ring.space_fd() ) and readable( ring.data_fd() ), "a full ring has no room" );
+
+  ring.pop( 1 );
+  expect( readable( ring.space_fd() ), "popping from a full ring should notify the producer" );
+  ring.push( "e" );
+  expect( not readable( ring.space_fd() ), "refilling the ring should drain the producer's notification" );
+
+  ring.pop( 4 );
+  expect( not readable( ring.data_fd() ) and readable( ring.space_fd() ), "an empty ring has no data" );
+  ring.push( "f" );
+  expect( readable( ring.data_fd() ), "pushing into an empty ring should notify the consumer" );
+  ring.pop( 1 );
+  expect( not readable( ring.data_fd() ), "emptying the ring should drain the consumer's notification" );
+
+  // with the conditions met, the waits return at once
+  ring.wait_until_writable();
+  ring.push( "g" );
+  ring.wait_until_readable();
+}
+
+// Closing lets the consumer finish what is buffered, then see the end; an error wakes up both sides
+void check_close_and_error()
+{
+  SharedByteRing ring { 4 };
+  ring.push( "ab" );
+  ring.close();
+  expect( ring.is_closed() and not ring.is_finished(), "closed with bytes still buffered" );
+  ring.pop( 2 );
+  expect( ring.is_finished(), "closed and fully popped" );
+  expect( readable( ring.data_fd() ), "the consumer should be woken up for the end of the stream" );
+  ring.wait_until_readable();
+
+  SharedByteRing full { 4 };
+  full.push( "abcd" );
+  SharedByteRing empty { 4 };
+  for ( auto* ring_with_error : { &full, &empty } ) {
+    ring_with_error->set_error();
+    expect( ring_with_error->has_error(), "set_error() wasn't seen" );
+    expect( readable( ring_with_error->data_fd() ) and readable( ring_with_error->space_fd() ),
+            "an error should wake up both sides" );
+  }
+  full.wait_until_writable();
+  empty.wait_until_readable();
+}
+
+// One thread pushes a known sequence of bytes through a small ring in pieces of varying sizes while another pops
+// it, each blocking when it has to
+void check_two_threads()
+{
+  constexpr size_t total = 4 << 20;
+  const auto byte_at = []( const size_t i ) { return static_cast<char>( ( i * 31 + i / 251 ) % 256 ); };
+  SharedByteRing ring { 100 };
+
+  thread producer { [&] {
+    string piece;
+    for ( size_t sent = 0, size = 1; sent < total; size = size % 300 + 7 ) {
+      piece.clear();
+      for ( size_t i = sent; i < min( total, sent + size ); ++i ) {
+        piece.push_back( byte_at( i ) );
+      }
+      for ( string_view rest = piece; not rest.empty(); ) {
+        ring.wait_until_writable();
+        rest.remove_prefix( ring.push( rest ) );
+      }
+      sent += piece.size();
+    }
+    ring.close();
+  } };
+
+  size_t received = 0;
+  bool in_order = true;
+  while ( not ring.is_finished() ) {
+    ring.wait_until_readable();
+    const string_view data = ring.peek();
+    for ( size_t i = 0; i < data.size(); ++i ) {
+      in_order = in_order and data[i] == byte_at( received + i );
+    }
+    received += data.size();
+    ring.pop( data.size() );
+  }
+  producer.join();
+
+  expect( in_order, "the consumer didn't see the bytes the producer pushed" );
+  expect( received == total, "received " + to_string( received ) + " bytes of " + to_string( total ) );
+}
+
+// The owner's end of a TCPMinnowSocket's outbound stream: the shared ring if enabled, or else the socket
+void send( LoopbackMinnowSocket& socket, const bool shared_rings, string_view data )
+{
+  if ( shared_rings ) {
+    SharedByteRing& ring = socket.outbound_ring();
+    while ( not data.empty() ) {
+      ring.wait_until_writable();
+      data.remove_prefix( ring.push( data ) );
+    }
+    ring.close();
+  } else {
+    while ( not data.empty() ) {
+      data.remove_prefix( socket.write( data ) );
+    }
+    socket.shutdown( SHUT_WR );
+  }
+}
+
+// The owner's end of a TCPMinnowSocket's inbound stream, read until it ends
+string receive( LoopbackMinnowSocket& socket, const bool shared_rings )
+{
+  string received;
+  if ( shared_rings ) {
+    SharedByteRing& ring = socket.inbound_ring();
+    while ( not ring.is_finished() and not ring.has_error() ) {
+      ring.wait_until_readable();
+      received += ring.peek();
+      ring.pop( ring.peek().size() );
+    }
+  } else {
+    string buffer;
+    do {
+      buffer.clear(); // (FileDescriptor::read() fills a non-empty buffer only up to its current size)
+      socket.read( buffer );
+      received += buffer;
+    } while ( not buffer.empty() );
+  }
+  return received;
+}
+
+// Two connected TCPMinnowSockets carry a stream each way between their owners, through the shared rings if they
+// were enabled and through the sockets otherwise
+void check_minnow_sockets( const bool shared_rings )
+{
+  auto [client_adapter, server_adapter] = LoopbackAdapter::make_pair();
+  LoopbackMinnowSocket client { move( client_adapter ) };
+  LoopbackMinnowSocket server { move( server_adapter ) };
+  if ( shared_rings ) {
+    client.enable_shared_rings( 1000 ); // (smaller than the streams, so the rings fill up and wrap around)
+    server.enable_shared_rings( 1000 );
+  } else {
+    bool threw = false;
+    try {
+      client.outbound_ring();
+    } catch ( const runtime_error& ) {
+      threw = true;
+    }
+    expect( threw, "outbound_ring() without enable_shared_rings() should throw" );
+  }
+
+  FdAdapterConfig client_config;
+  FdAdapterConfig server_config;
+  client_config.source = server_config.destination = Address { "10.0.0.1", 1000 };
+  client_config.destination = server_config.source = Address { "10.0.0.2", 2000 };
+  TCPConfig cfg;
+  cfg.rt_timeout = 10; // (keeps the linger after the streams end short)
+
+  thread accept_thread { [&] { server.listen_and_accept( cfg, server_config ); } };
+  client.connect( cfg, client_config );
+  accept_thread.join();
+  client.set_blocking( true );
+  server.set_blocking( true );
+
+  string upload;
+  string download;
+  for ( size_t i = 0; i < 300'000; ++i ) {
+    upload.push_back( static_cast<char>( i * 7 % 251 ) );
+    download.push_back( static_cast<char>( i * 13 % 241 ) );
+  }
+
+  string uploaded;
+  thread client_sender { [&] { send( client, shared_rings, upload ); } };
+  thread server_sender { [&] { send( server, shared_rings, download ); } };
+  thread server_receiver { [&] { uploaded = receive( server, shared_rings ); } };
+  const string downloaded = receive( client, shared_rings );
+  client_sender.join();
+  server_sender.join();
+  server_receiver.join();
+  client.wait_until_closed();
+  server.wait_until_closed();
+
+  const string path = shared_rings ? " through the shared rings" : " through the sockets";
+  expect( uploaded == upload, "the server didn't receive what the client sent" + path );
+  expect( downloaded == download, "the client didn't receive what the server sent" + path );
+}
+} // namespace
+
+int main()
+{
+  try {
+    check_wrap_around();
+    check_notifications();
+    check_close_and_error();
+    check_two_threads();
+    check_minnow_sockets( true );
+    check_minnow_sockets( false );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
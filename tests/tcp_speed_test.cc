@@ -0,0 +1,351 @@
+#include "loopback_adapter.hh"
+#include "netem_fd_adapter.hh"
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_minnow_socket.hh"
+#include "tcp_peer.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+uint64_t cycle_count()
+{
+#ifdef HAVE_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Move `input_len` bytes from one TCPPeer to another, through the full sender, receiver, reassembler and
+// ByteStream path, with the two peers connected by a pair of in-process LoopbackAdapters.
+void speed_test( const size_t input_len, const bool serialize_ipv4 )
+{
+  // The data is a random block, repeated as needed to reach input_len
+  const string block = [] {
+    auto rd = get_random_engine();
+    uniform_int_distribution<char> ud;
+    string ret( 1 << 20, 0 );
+    for ( auto& ch : ret ) {
+      ch = ud( rd );
+    }
+    return ret;
+  }();
+
+  auto [client_adapter, server_adapter] = LoopbackAdapter::make_pair( serialize_ipv4 );
+  const Address client_address { "10.0.0.1", 1000 };
+  const Address server_address { "10.0.0.2", 2000 };
+  client_adapter.config_mut().source = server_adapter.config_mut().destination = client_address;
+  client_adapter.config_mut().destination = server_adapter.config_mut().source = server_address;
+
+  TCPConfig cfg;
+  TCPPeer client { cfg };
+  TCPPeer server { cfg };
+  const auto client_transmit = [&]( const TCPMessage& msg ) { client_adapter.write( msg ); };
+  const auto server_transmit = [&]( const TCPMessage& msg ) { server_adapter.write( msg ); };
+
+  size_t bytes_written = 0;
+  size_t bytes_read = 0;
+
+  const auto start_copies = Buffer::copy_stats();
+  const auto start_time = steady_clock::now();
+  const auto start_cycles = cycle_count();
+
+  while ( not server.inbound_reader().is_finished() ) {
+    // The client application writes as much as its outbound stream will take
+    Writer& outbound = client.outbound_writer();
+    while ( bytes_written < input_len and outbound.available_capacity() > 0 ) {
+      const auto offset = bytes_written % block.size();
+      const auto len = min( { outbound.available_capacity(), block.size() - offset, input_len - bytes_written } );
+      outbound.push( block.substr( offset, len ) );
+      bytes_written += len;
+    }
+    if ( bytes_written == input_len and not outbound.is_closed() ) {
+      outbound.close();
+    }
+    client.push( client_transmit );
+    server.push( server_transmit );
+
+    bool progress = false;
+    while ( auto msg = server_adapter.read() ) {
+      server.receive( move( msg.value() ), server_transmit );
+      progress = true;
+    }
+    while ( auto msg = client_adapter.read() ) {
+      client.receive( move( msg.value() ), client_transmit );
+      progress = true;
+    }
+
+    // The server application reads and checks everything that has arrived
+    Reader& inbound = server.inbound_reader();
+    while ( inbound.bytes_buffered() ) {
+      const string_view chunk = inbound.peek();
+      const auto offset = bytes_read % block.size();
+      const auto len = min( chunk.size(), block.size() - offset );
+      if ( chunk.substr( 0, len ) != string_view { block }.substr( offset, len ) ) {
+        throw runtime_error( "Mismatch between data written and read" );
+      }
+      inbound.pop( len );
+      bytes_read += len;
+    }
+
+    if ( not progress and not server.inbound_reader().is_finished() ) {
+      throw runtime_error( "TCPPeers stopped making progress after " + to_string( bytes_read ) + " bytes" );
+    }
+  }
+
+  const auto stop_cycles = cycle_count();
+  const auto stop_time = steady_clock::now();
+  const auto stop_copies = Buffer::copy_stats();
+
+  if ( bytes_read != input_len ) {
+    throw runtime_error( "Expected " + to_string( input_len ) + " bytes but read " + to_string( bytes_read ) );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto bytes_per_second = static_cast<double>( input_len ) / test_duration.count();
+  auto bits_per_second = 8 * bytes_per_second;
+  auto gigabits_per_second = bits_per_second / 1e9;
+  auto cycles_per_byte = static_cast<double>( stop_cycles - start_cycles ) / static_cast<double>( input_len );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  const string mode = serialize_ipv4 ? "serialized IPv4" : "in-memory messages";
+  cout << "TCPPeer to TCPPeer (" << mode << ") moved " << input_len << " bytes at " << fixed << setprecision( 2 )
+       << gigabits_per_second << " Gbit/s";
+#ifdef HAVE_RDTSC
+  cout << ", " << cycles_per_byte << " cycles/byte";
+#endif
+  cout << ".\n";
+
+  // Between the application's write and its read, the payload is copied once: into the Reassembler, which
+  // takes ownership of it as a std::string. Serialized, each TCP header is also copied in behind its IPv4 header.
+  const auto copies = static_cast<double>( stop_copies.bytes - start_copies.bytes );
+  cout << "  (bytes copied per payload byte moved: " << copies / static_cast<double>( input_len ) << ", in "
+       << stop_copies.copies - start_copies.copies << " copies)\n";
+
+  debug_output << "             TCP throughput (" << mode << "): " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "TCPPeer did not meet minimum speed of 0.1 Gbit/s." );
+  }
+}
+
+// Move `input_len` bytes over an emulated path (delay, bottleneck rate and random loss in each direction).
+// Time is simulated: whenever nothing is left to do, every peer and adapter is ticked straight to the next
+// timer, so the test reports how long the transfer would have taken on such a path.
+void emulated_path_test( const size_t input_len )
+{
+  auto [client_loopback, server_loopback] = LoopbackAdapter::make_pair();
+  NetemFdAdapter<LoopbackAdapter> client_adapter { move( client_loopback ) };
+  NetemFdAdapter<LoopbackAdapter> server_adapter { move( server_loopback ) };
+  for ( auto* adapter : { &client_adapter, &server_adapter } ) {
+    auto& netem = adapter->config_mut().netem_up;
+    netem.delay = 10ms;
+    netem.rate = 12'500'000; // 100 Mbit/s
+    netem.queue_limit = 100;
+    netem.loss_good = 65536 / 200; // 0.5%
+  }
+
+  TCPConfig cfg;
+  TCPPeer client { cfg };
+  TCPPeer server { cfg };
+  const auto client_transmit = [&]( const TCPMessage& msg ) { client_adapter.write( msg ); };
+  const auto server_transmit = [&]( const TCPMessage& msg ) { server_adapter.write( msg ); };
+
+  const string data( input_len, 'x' );
+  size_t bytes_written = 0;
+  size_t bytes_read = 0;
+  microseconds now {};
+
+  while ( not server.inbound_reader().is_finished() ) {
+    Writer& outbound = client.outbound_writer();
+    if ( bytes_written < input_len ) {
+      const auto len = min( outbound.available_capacity(), input_len - bytes_written );
+      outbound.push( data.substr( bytes_written, len ) );
+      bytes_written += len;
+    }
+    if ( bytes_written == input_len and not outbound.is_closed() ) {
+      outbound.close();
+    }
+    client.push( client_transmit );
+    server.push( server_transmit );
+
+    bool progress = false;
+    while ( auto msg = server_adapter.read() ) {
+      server.receive( move( msg.value() ), server_transmit );
+      progress = true;
+    }
+    while ( auto msg = client_adapter.read() ) {
+      client.receive( move( msg.value() ), client_transmit );
+      progress = true;
+    }
+
+    Reader& inbound = server.inbound_reader();
+    bytes_read += inbound.bytes_buffered();
+    inbound.pop( inbound.bytes_buffered() );
+
+    if ( progress ) {
+      continue;
+    }
+
+    // Nothing to do until the next timer: jump straight to it
+    optional<microseconds> next;
+    for ( const auto t : { client.next_timeout(),
+                           server.next_timeout(),
+                           client_adapter.next_timeout(),
+                           server_adapter.next_timeout() } ) {
+      if ( t.has_value() ) {
+        next = min( next.value_or( t.value() ), t.value() );
+      }
+    }
+    if ( not next.has_value() ) {
+      throw runtime_error( "TCPPeers stalled on the emulated path after " + to_string( bytes_read ) + " bytes" );
+    }
+    now += next.value();
+    client.tick( next.value(), client_transmit );
+    server.tick( next.value(), server_transmit );
+    client_adapter.tick( next.value() );
+    server_adapter.tick( next.value() );
+  }
+
+  if ( bytes_read != input_len ) {
+    throw runtime_error( "Expected " + to_string( input_len ) + " bytes but read " + to_string( bytes_read ) );
+  }
+
+  const auto seconds = duration_cast<duration<double>>( now ).count();
+  cout << "TCPPeer to TCPPeer (emulated 100 Mbit/s, 20 ms RTT, 0.5% loss path) moved " << input_len
+       << " bytes in " << fixed << setprecision( 2 ) << seconds << " simulated seconds ("
+       << static_cast<double>( input_len ) * 8 / seconds / 1e6 << " Mbit/s).\n";
+}
+
+// Move `input_len` bytes between two LoopbackMinnowSockets, each with its own TCPPeer thread. The application
+// exchanges data with the TCPPeer threads either through the sockets (a kernel socketpair) or through the
+// shared rings.
+void minnow_socket_test( const size_t input_len, const bool shared_rings )
+{
+  const string data( input_len, 'x' );
+
+  auto [client_adapter, server_adapter] = LoopbackAdapter::make_pair();
+  LoopbackMinnowSocket client { move( client_adapter ) };
+  LoopbackMinnowSocket server { move( server_adapter ) };
+  if ( shared_rings ) {
+    client.enable_shared_rings();
+    server.enable_shared_rings();
+  }
+
+  FdAdapterConfig client_config;
+  FdAdapterConfig server_config;
+  client_config.source = server_config.destination = Address { "10.0.0.1", 1000 };
+  client_config.destination = server_config.source = Address { "10.0.0.2", 2000 };
+  TCPConfig cfg;
+  cfg.rt_timeout = 10; // keeps the linger after the transfer short
+
+  thread accept_thread { [&] { server.listen_and_accept( cfg, server_config ); } };
+  client.connect( cfg, client_config );
+  accept_thread.join();
+  client.set_blocking( true );
+  server.set_blocking( true );
+
+  const auto start_time = steady_clock::now();
+
+  thread writer { [&] {
+    string_view remaining { data };
+    if ( shared_rings ) {
+      SharedByteRing& ring = client.outbound_ring();
+      while ( not remaining.empty() ) {
+        ring.wait_until_writable();
+        remaining.remove_prefix( ring.push( remaining ) );
+      }
+      ring.close();
+    } else {
+      while ( not remaining.empty() ) {
+        remaining.remove_prefix( client.write( remaining ) );
+      }
+      client.shutdown( SHUT_WR );
+    }
+  } };
+
+  size_t bytes_read = 0;
+  if ( shared_rings ) {
+    SharedByteRing& ring = server.inbound_ring();
+    while ( not ring.is_finished() and not ring.has_error() ) {
+      ring.wait_until_readable();
+      const auto len = ring.peek().size();
+      ring.pop( len );
+      bytes_read += len;
+    }
+  } else {
+    string buffer;
+    do {
+      buffer.clear(); // FileDescriptor::read() fills a non-empty buffer only up to its current size
+      server.read( buffer );
+      bytes_read += buffer.size();
+    } while ( not buffer.empty() );
+  }
+
+  const auto stop_time = steady_clock::now();
+  writer.join();
+  server.shutdown( SHUT_WR );
+  if ( shared_rings ) {
+    server.outbound_ring().close();
+  }
+  client.wait_until_closed();
+  server.wait_until_closed();
+
+  if ( bytes_read != input_len ) {
+    throw runtime_error( "Expected " + to_string( input_len ) + " bytes but read " + to_string( bytes_read ) );
+  }
+
+  const auto seconds = duration_cast<duration<double>>( stop_time - start_time ).count();
+  const string mode = shared_rings ? "shared rings" : "socketpair";
+  cout << "LoopbackMinnowSocket to LoopbackMinnowSocket (" << mode << ") moved " << input_len << " bytes at "
+       << fixed << setprecision( 2 ) << static_cast<double>( input_len ) * 8 / seconds / 1e9 << " Gbit/s.\n";
+}
+
+void program_body( const size_t input_len )
+{
+  speed_test( input_len, false );
+  speed_test( input_len / 4, true );
+  emulated_path_test( min<size_t>( input_len, 4'000'000 ) );
+  minnow_socket_test( input_len / 20, false );
+  minnow_socket_test( input_len / 20, true );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    // optional argument: number of bytes to move (default 1 GB)
+    const size_t input_len = argc > 1 ? strtoull( argv[1], nullptr, 0 ) : 1'000'000'000; // NOLINT(*-pointer-arith)
+    program_body( input_len );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
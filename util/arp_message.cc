@@ -1,4 +1,5 @@
 #include "arp_message.hh"
+#include "header_codec.hh"
 
 #include <arpa/inet.h>
 #include <iomanip>
@@ -6,6 +7,29 @@
 
 using namespace std;
 
+namespace {
+// (for Ethernet and IPv4, the only combination supported)
+using HardwareType = HeaderField<0, 16>;
+using ProtocolType = HeaderField<16, 16>;
+using HardwareAddressSize = HeaderField<32, 8>;
+using ProtocolAddressSize = HeaderField<40, 8>;
+using Opcode = HeaderField<48, 16>;
+using SenderEthernetAddress = HeaderBytes<8, 6>;
+using SenderIPAddress = HeaderField<112, 32>;
+using TargetEthernetAddress = HeaderBytes<18, 6>;
+using TargetIPAddress = HeaderField<192, 32>;
+using Layout = HeaderLayout<ARPMessage::LENGTH,
+                            HardwareType,
+                            ProtocolType,
+                            HardwareAddressSize,
+                            ProtocolAddressSize,
+                            Opcode,
+                            SenderEthernetAddress,
+                            SenderIPAddress,
+                            TargetEthernetAddress,
+                            TargetIPAddress>;
+} // namespace
+
 bool ARPMessage::supported() const
 {
   return hardware_type == TYPE_ETHERNET and protocol_type == EthernetHeader::TYPE_IPv4
@@ -32,28 +56,23 @@ string ARPMessage::to_string() const
 
 void ARPMessage::parse( Parser& parser )
 {
-  parser.integer( hardware_type );
-  parser.integer( protocol_type );
-  parser.integer( hardware_address_size );
-  parser.integer( protocol_address_size );
-  parser.integer( opcode );
+  Layout::read( parser, [&]( const char* raw ) {
+    hardware_type = HardwareType::get( raw );
+    protocol_type = ProtocolType::get( raw );
+    hardware_address_size = HardwareAddressSize::get( raw );
+    protocol_address_size = ProtocolAddressSize::get( raw );
+    opcode = Opcode::get( raw );
 
-  if ( not supported() ) {
-    parser.set_error();
-    return;
-  }
+    sender_ethernet_address = SenderEthernetAddress::get( raw );
+    sender_ip_address = SenderIPAddress::get( raw );
 
-  // read sender addresses (Ethernet and IP)
-  for ( auto& b : sender_ethernet_address ) {
-    parser.integer( b );
-  }
-  parser.integer( sender_ip_address );
+    target_ethernet_address = TargetEthernetAddress::get( raw );
+    target_ip_address = TargetIPAddress::get( raw );
+  } );
 
-  // read target addresses (Ethernet and IP)
-  for ( auto& b : target_ethernet_address ) {
-    parser.integer( b );
+  if ( not supported() ) {
+    parser.set_error();
   }
-  parser.integer( target_ip_address );
 }
 
 void ARPMessage::serialize( Serializer& serializer ) const
@@ -62,21 +81,17 @@ void ARPMessage::serialize( Serializer& serializer ) const
     throw runtime_error( "ARPMessage: unsupported field combination (must be Ethernet/IP, and request or reply)" );
   }
 
-  serializer.integer( hardware_type );
-  serializer.integer( protocol_type );
-  serializer.integer( hardware_address_size );
-  serializer.integer( protocol_address_size );
-  serializer.integer( opcode );
+  Layout::write( serializer, [&]( char* raw ) {
+    HardwareType::set( raw, hardware_type );
+    ProtocolType::set( raw, protocol_type );
+    HardwareAddressSize::set( raw, hardware_address_size );
+    ProtocolAddressSize::set( raw, protocol_address_size );
+    Opcode::set( raw, opcode );
 
-  // read sender addresses (Ethernet and IP)
-  for ( const auto& b : sender_ethernet_address ) {
-    serializer.integer( b );
-  }
-  serializer.integer( sender_ip_address );
+    SenderEthernetAddress::set( raw, sender_ethernet_address );
+    SenderIPAddress::set( raw, sender_ip_address );
 
-  // read target addresses (Ethernet and IP)
-  for ( const auto& b : target_ethernet_address ) {
-    serializer.integer( b );
-  }
-  serializer.integer( target_ip_address );
+    TargetEthernetAddress::set( raw, target_ethernet_address );
+    TargetIPAddress::set( raw, target_ip_address );
+  } );
 }
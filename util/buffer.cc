@@ -0,0 +1,132 @@
+#include "buffer.hh"
+#include "checksum.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+using namespace std;
+
+namespace {
+atomic<uint64_t> total_copies {};
+atomic<uint64_t> total_bytes_copied {};
+} // namespace
+
+Buffer::Buffer( string&& str ) : size_( str.size() )
+{
+  if ( not str.empty() ) {
+    storage_ = make_shared<string>( move( str ) );
+  }
+}
+
+Buffer::Buffer( const string& str ) : size_( str.size() )
+{
+  string copy( str.size(), 0 );
+  checksum_partial_ = internet_checksum_copy( copy.data(), str );
+  record_copy( str.size() );
+  if ( not copy.empty() ) {
+    storage_ = make_shared<string>( move( copy ) );
+  }
+}
+
+Buffer::Buffer( string&& str, const uint16_t checksum_partial ) : Buffer( move( str ) )
+{
+  checksum_partial_ = checksum_partial;
+}
+
+Buffer Buffer::substr( const size_t pos, const size_t len ) const
+{
+  Buffer ret { *this };
+  ret.remove_prefix( pos );
+  ret.remove_suffix( ret.size() - min( len, ret.size() ) );
+  return ret;
+}
+
+void Buffer::remove_prefix( const size_t len )
+{
+  const size_t n = min( len, size_ );
+  offset_ += n;
+  size_ -= n;
+  if ( n ) {
+    checksum_partial_.reset();
+  }
+}
+
+void Buffer::remove_suffix( const size_t len )
+{
+  const size_t n = min( len, size_ );
+  size_ -= n;
+  if ( n ) {
+    checksum_partial_.reset();
+  }
+}
+
+uint16_t Buffer::checksum_partial() const
+{
+  return checksum_partial_.has_value() ? checksum_partial_.value() : internet_checksum_partial( view() );
+}
+
+string Buffer::copy_out() const
+{
+  record_copy( size_ );
+  return string { view() };
+}
+
+void Buffer::unshare()
+{
+  if ( storage_ and storage_.use_count() > 1 ) {
+    string copy( size_, 0 );
+    checksum_partial_ = internet_checksum_copy( copy.data(), view() );
+    record_copy( size_ );
+    storage_ = make_shared<string>( move( copy ) );
+    offset_ = 0;
+  }
+}
+
+char* Buffer::mutable_data()
+{
+  unshare();
+  checksum_partial_.reset();
+  return storage_ ? storage_->data() + offset_ : nullptr;
+}
+
+Buffer::operator string() const
+{
+  return copy_out();
+}
+
+string Buffer::release() &&
+{
+  if ( not storage_ ) {
+    return {};
+  }
+
+  // Nobody else can see the storage, so it can be trimmed to this slice in place
+  if ( storage_.use_count() == 1 ) {
+    string ret = move( *storage_ );
+    storage_.reset();
+    const size_t offset = exchange( offset_, 0 );
+    const size_t size = exchange( size_, 0 );
+    if ( offset ) {
+      record_copy( size ); // the erase moves the bytes down
+      ret.erase( 0, offset );
+    }
+    ret.resize( size );
+    return ret;
+  }
+
+  return copy_out();
+}
+
+Buffer::CopyStats Buffer::copy_stats()
+{
+  return { total_copies.load( memory_order_relaxed ), total_bytes_copied.load( memory_order_relaxed ) };
+}
+
+void Buffer::record_copy( const size_t len )
+{
+  if ( len ) {
+    total_copies.fetch_add( 1, memory_order_relaxed );
+    total_bytes_copied.fetch_add( len, memory_order_relaxed );
+  }
+}
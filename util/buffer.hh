@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+//! \brief A reference-counted, immutable string of bytes, which may be a slice of a larger one
+//! \details Copying a Buffer, or taking a substr() of it, shares its bytes instead of copying them, so a
+//! payload can be passed up and down the stack, queued, and kept for retransmission without being copied.
+//! The operations that do have to copy bytes are counted (see copy_stats()).
+class Buffer
+{
+  std::shared_ptr<std::string> storage_ {};
+  size_t offset_ {};
+  size_t size_ {};
+  std::optional<uint16_t> checksum_partial_ {}; // of this slice, when known
+
+  std::string copy_out() const;
+
+public:
+  Buffer() = default;
+
+  //! Take ownership of a string (without copying it)
+  Buffer( std::string&& str ); // NOLINT(*-explicit-*)
+
+  //! Copy a string into a new Buffer (counted as a copy, and checksummed on the way)
+  Buffer( const std::string& str ); // NOLINT(*-explicit-*)
+
+  //! Take ownership of a string whose internet_checksum_partial() is already known
+  Buffer( std::string&& str, uint16_t checksum_partial );
+
+  size_t size() const { return size_; }
+  size_t length() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  std::string_view view() const { return storage_ ? std::string_view { *storage_ }.substr( offset_, size_ ) : ""; }
+  operator std::string_view() const { return view(); } // NOLINT(*-explicit-*)
+
+  //! A Buffer sharing up to `len` bytes of this one, starting at `pos` (like std::string::substr)
+  Buffer substr( size_t pos, size_t len = std::string::npos ) const;
+
+  void remove_prefix( size_t len );
+  void remove_suffix( size_t len );
+
+  //! \brief internet_checksum_partial() of the bytes
+  //! \details Known without another pass over them if they were copied into this Buffer (see unshare()).
+  uint16_t checksum_partial() const;
+
+  //! \brief Give this Buffer its own copy of its bytes, unless it already is the only reference to them
+  //! \details The copy is counted, and checksummed on the way (see internet_checksum_copy()).
+  void unshare();
+
+  //! Are the bytes shared with another Buffer (so that writing them would mean copying them first)?
+  bool shared() const { return storage_ and storage_.use_count() > 1; }
+
+  //! Is this Buffer `whole`'s own bytes (not merely equal ones) from `pos` on, as a substr() of it would be?
+  bool is_slice_of( const Buffer& whole, size_t pos ) const
+  {
+    return storage_ and storage_ == whole.storage_ and offset_ == whole.offset_ + pos
+           and pos + size_ <= whole.size_;
+  }
+
+  //! \brief Write access to the bytes, for editing them in place
+  //! \details They are unshare()d first, so no other Buffer sees the change.
+  char* mutable_data();
+
+  //! Copy the bytes out into a std::string (counted as a copy)
+  explicit operator std::string() const;
+
+  //! \brief Give up the bytes as a std::string
+  //! \details They are moved if this is the only reference to its storage, and copied otherwise.
+  std::string release() &&;
+
+  bool operator==( std::string_view other ) const { return view() == other; }
+
+  //! How many times, and how many bytes, have Buffer operations (or record_copy()) copied (in all threads)?
+  struct CopyStats
+  {
+    uint64_t copies;
+    uint64_t bytes;
+  };
+  static CopyStats copy_stats();
+
+  //! Count a copy of bytes made outside Buffer, e.g. when gathering several Buffers into one
+  static void record_copy( size_t len );
+};
@@ -0,0 +1,204 @@
+#include "checksum.hh"
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+using namespace std;
+
+// Each kernel adds up the data as native-endian words in a 64-bit accumulator, and leaves the folding and
+// byte order to internet_checksum_partial(). The one's-complement sum commutes with byte swapping
+// (RFC 1071, 2(B)), so on a little-endian machine one swap at the end gives the big-endian sum. With COPY, a
+// kernel also stores the data to `dst` as it goes, so each byte is loaded only once.
+
+namespace {
+template<bool COPY>
+uint64_t sum_scalar( const char* data, size_t len, char* dst )
+{
+  uint64_t sum = 0;
+  for ( ; len >= sizeof( uint64_t ); data += sizeof( uint64_t ), len -= sizeof( uint64_t ) ) {
+    uint64_t word {};
+    memcpy( &word, data, sizeof( word ) );
+    if constexpr ( COPY ) {
+      memcpy( dst, &word, sizeof( word ) );
+      dst += sizeof( word );
+    }
+    sum += ( word & 0xffff'ffff ) + ( word >> 32 );
+  }
+  for ( ; len >= sizeof( uint16_t ); data += sizeof( uint16_t ), len -= sizeof( uint16_t ) ) {
+    uint16_t word {};
+    memcpy( &word, data, sizeof( word ) );
+    if constexpr ( COPY ) {
+      memcpy( dst, &word, sizeof( word ) );
+      dst += sizeof( word );
+    }
+    sum += word;
+  }
+  if ( len ) {
+    uint16_t word = 0; // a trailing odd byte is padded with zero
+    memcpy( &word, data, 1 );
+    if constexpr ( COPY ) {
+      *dst = *data;
+    }
+    sum += word;
+  }
+  return sum;
+}
+
+#ifdef HAVE_X86_SIMD
+template<bool COPY>
+uint64_t sum_sse2( const char* data, size_t len, char* dst )
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc0 = zero;
+  __m128i acc1 = zero;
+  // widen each 32-bit word to a 64-bit lane, so the accumulators cannot overflow
+  for ( ; len >= 32; data += 32, len -= 32 ) {
+    const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) );      // NOLINT
+    const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + 16 ) ); // NOLINT
+    if constexpr ( COPY ) {
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst ), a );      // NOLINT
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst + 16 ), b ); // NOLINT
+      dst += 32;
+    }
+    acc0 = _mm_add_epi64( acc0, _mm_unpacklo_epi32( a, zero ) );
+    acc1 = _mm_add_epi64( acc1, _mm_unpackhi_epi32( a, zero ) );
+    acc0 = _mm_add_epi64( acc0, _mm_unpacklo_epi32( b, zero ) );
+    acc1 = _mm_add_epi64( acc1, _mm_unpackhi_epi32( b, zero ) );
+  }
+
+  alignas( 16 ) uint64_t lanes[2];
+  _mm_store_si128( reinterpret_cast<__m128i*>( lanes ), _mm_add_epi64( acc0, acc1 ) ); // NOLINT
+  return lanes[0] + lanes[1] + sum_scalar<COPY>( data, len, dst );
+}
+
+template<bool COPY>
+__attribute__( ( target( "avx2" ) ) ) uint64_t sum_avx2( const char* data, size_t len, char* dst )
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc0 = zero;
+  __m256i acc1 = zero;
+  for ( ; len >= 64; data += 64, len -= 64 ) {
+    const __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data ) );      // NOLINT
+    const __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + 32 ) ); // NOLINT
+    if constexpr ( COPY ) {
+      _mm256_storeu_si256( reinterpret_cast<__m256i*>( dst ), a );      // NOLINT
+      _mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + 32 ), b ); // NOLINT
+      dst += 64;
+    }
+    acc0 = _mm256_add_epi64( acc0, _mm256_unpacklo_epi32( a, zero ) );
+    acc1 = _mm256_add_epi64( acc1, _mm256_unpackhi_epi32( a, zero ) );
+    acc0 = _mm256_add_epi64( acc0, _mm256_unpacklo_epi32( b, zero ) );
+    acc1 = _mm256_add_epi64( acc1, _mm256_unpackhi_epi32( b, zero ) );
+  }
+
+  alignas( 32 ) uint64_t lanes[4];
+  _mm256_store_si256( reinterpret_cast<__m256i*>( lanes ), _mm256_add_epi64( acc0, acc1 ) ); // NOLINT
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_sse2<COPY>( data, len, dst );
+}
+#endif
+
+uint16_t fold( uint64_t sum )
+{
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + ( sum & 0xffff );
+  }
+  auto ret = static_cast<uint16_t>( sum );
+  if constexpr ( endian::native == endian::little ) {
+    ret = static_cast<uint16_t>( ret << 8 | ret >> 8 );
+  }
+  return ret;
+}
+
+template<bool COPY>
+uint64_t sum_with( const ChecksumKernel kernel, const string_view data, char* dst )
+{
+  switch ( kernel ) {
+    case ChecksumKernel::Scalar:
+      return sum_scalar<COPY>( data.data(), data.size(), dst );
+#ifdef HAVE_X86_SIMD
+    case ChecksumKernel::SSE2:
+      return sum_sse2<COPY>( data.data(), data.size(), dst );
+    case ChecksumKernel::AVX2:
+      return sum_avx2<COPY>( data.data(), data.size(), dst );
+#endif
+    default:
+      throw runtime_error( "checksum kernel not supported on this CPU" );
+  }
+}
+
+// below a few vectors' worth, the setup and horizontal sum cost more than the vector loop saves
+constexpr size_t SIMD_THRESHOLD = 64;
+
+ChecksumKernel kernel_for( const size_t len )
+{
+  return len < SIMD_THRESHOLD ? ChecksumKernel::Scalar : best_checksum_kernel();
+}
+} // namespace
+
+bool checksum_kernel_supported( const ChecksumKernel kernel )
+{
+  switch ( kernel ) {
+    case ChecksumKernel::Scalar:
+      return true;
+#ifdef HAVE_X86_SIMD
+    case ChecksumKernel::SSE2:
+      return true; // part of the x86-64 baseline
+    case ChecksumKernel::AVX2:
+      return __builtin_cpu_supports( "avx2" );
+#endif
+    default:
+      return false;
+  }
+}
+
+ChecksumKernel best_checksum_kernel()
+{
+  static const ChecksumKernel best = [] {
+    for ( const auto kernel : { ChecksumKernel::AVX2, ChecksumKernel::SSE2 } ) {
+      if ( checksum_kernel_supported( kernel ) ) {
+        return kernel;
+      }
+    }
+    return ChecksumKernel::Scalar;
+  }();
+  return best;
+}
+
+string_view checksum_kernel_name( const ChecksumKernel kernel )
+{
+  switch ( kernel ) {
+    case ChecksumKernel::Scalar:
+      return "scalar";
+    case ChecksumKernel::SSE2:
+      return "SSE2";
+    case ChecksumKernel::AVX2:
+      return "AVX2";
+  }
+  return "unknown";
+}
+
+uint16_t internet_checksum_partial( const string_view data )
+{
+  return internet_checksum_partial( data, kernel_for( data.size() ) );
+}
+
+uint16_t internet_checksum_partial( const string_view data, const ChecksumKernel kernel )
+{
+  return fold( sum_with<false>( kernel, data, nullptr ) );
+}
+
+uint16_t internet_checksum_copy( char* dst, const string_view src )
+{
+  return internet_checksum_copy( dst, src, kernel_for( src.size() ) );
+}
+
+uint16_t internet_checksum_copy( char* dst, const string_view src, const ChecksumKernel kernel )
+{
+  return fold( sum_with<true>( kernel, src, dst ) );
+}
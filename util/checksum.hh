@@ -1,9 +1,44 @@
 #pragma once
 
+#include "buffer.hh"
+
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+//! Implementations of the one's-complement sum behind InternetChecksum
+enum class ChecksumKernel
+{
+  Scalar, //!< Portable, 64 bits at a time
+  SSE2,   //!< 16 bytes at a time (x86-64 only)
+  AVX2    //!< 32 bytes at a time (x86-64 CPUs with AVX2 only)
+};
+
+//! Is `kernel` available on this CPU?
+bool checksum_kernel_supported( ChecksumKernel kernel );
+
+//! The fastest kernel available on this CPU
+ChecksumKernel best_checksum_kernel();
+
+//! The kernel's name (e.g. "AVX2"), for reports
+std::string_view checksum_kernel_name( ChecksumKernel kernel );
+
+//! \brief One's-complement sum of `data`, read as big-endian 16-bit words, folded to 16 bits
+//! \details A trailing odd byte is padded with a zero byte, as RFC 1071 specifies.
+uint16_t internet_checksum_partial( std::string_view data );
+
+//! internet_checksum_partial() with a specific kernel (e.g. to benchmark them against each other)
+uint16_t internet_checksum_partial( std::string_view data, ChecksumKernel kernel );
+
+//! \brief Copy `src` to `dst` (which must have room for it) and return internet_checksum_partial( src )
+//! \details Like the kernel's csum_partial_copy: each byte is loaded once, for both the copy and the sum.
+uint16_t internet_checksum_copy( char* dst, std::string_view src );
+
+//! internet_checksum_copy() with a specific kernel
+uint16_t internet_checksum_copy( char* dst, std::string_view src, ChecksumKernel kernel );
+
 //! The internet checksum algorithm
 class InternetChecksum
 {
@@ -13,16 +48,38 @@ private:
 
 public:
   explicit InternetChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
-  void add( std::string_view data )
+  void add( std::string_view data ) { add_partial( internet_checksum_partial( data ), data.size() ); }
+
+  //! Add `len` bytes whose internet_checksum_partial() is already known (e.g. from internet_checksum_copy())
+  void add_partial( uint16_t partial, const size_t len )
   {
-    for ( const uint8_t i : data ) {
-      uint16_t val = i;
-      if ( not parity_ ) {
-        val <<= 8;
-      }
-      sum_ += val;
-      parity_ = !parity_;
+    // A chunk that starts at an odd offset has its bytes in the other halves of each word (RFC 1071, 2(B))
+    if ( parity_ ) {
+      partial = static_cast<uint16_t>( partial << 8 | partial >> 8 );
     }
+    sum_ += partial;
+    parity_ = parity_ != ( len % 2 == 1 );
+  }
+
+  //! Copy `src` to `dst` while adding it (see internet_checksum_copy())
+  void add_copy( char* dst, std::string_view src ) { add_partial( internet_checksum_copy( dst, src ), src.size() ); }
+
+  //! \brief Update a checksum in place of recomputing it, after one 16-bit word it covers changes (RFC 1624)
+  //! \details Uses eqn. 3, HC' = ~(~HC + ~m + m'), which never produces the -0 that eqn. 2 can.
+  static constexpr uint16_t adjust( const uint16_t cksum, const uint16_t old_word, const uint16_t new_word )
+  {
+    uint32_t sum = static_cast<uint16_t>( ~cksum ) + static_cast<uint16_t>( ~old_word ) + new_word;
+    sum = ( sum >> 16 ) + ( sum & 0xffff );
+    sum += sum >> 16;
+    return ~static_cast<uint16_t>( sum );
+  }
+
+  //! adjust() for a 32-bit field (e.g. an address), which covers two words
+  static constexpr uint16_t adjust32( const uint16_t cksum, const uint32_t old_field, const uint32_t new_field )
+  {
+    return adjust( adjust( cksum, old_field >> 16, new_field >> 16 ),
+                   static_cast<uint16_t>( old_field ),
+                   static_cast<uint16_t>( new_field ) );
   }
 
   uint16_t value() const
@@ -36,6 +93,13 @@ public:
     return ~ret;
   }
 
+  void add( const std::vector<Buffer>& data )
+  {
+    for ( const auto& x : data ) {
+      add( x );
+    }
+  }
+
   void add( const std::vector<std::string>& data )
   {
     for ( const auto& x : data ) {
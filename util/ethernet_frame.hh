@@ -1,5 +1,6 @@
 #pragma once
 
+#include "buffer.hh"
 #include "ethernet_header.hh"
 #include "parser.hh"
 
@@ -8,7 +9,7 @@
 struct EthernetFrame
 {
   EthernetHeader header {};
-  std::vector<std::string> payload {};
+  std::vector<Buffer> payload {};
 
   void parse( Parser& parser )
   {
@@ -16,9 +17,15 @@ struct EthernetFrame
     parser.all_remaining( payload );
   }
 
-  void serialize( Serializer& serializer ) const
+  void serialize( Serializer& serializer ) const&
   {
     header.serialize( serializer );
     serializer.buffer( payload );
   }
+
+  void serialize( Serializer& serializer ) &&
+  {
+    header.serialize( serializer );
+    serializer.buffer( std::move( payload ) );
+  }
 };
@@ -1,10 +1,18 @@
 #include "ethernet_header.hh"
+#include "header_codec.hh"
 
 #include <iomanip>
 #include <sstream>
 
 using namespace std;
 
+namespace {
+using Dst = HeaderBytes<0, 6>;
+using Src = HeaderBytes<6, 6>;
+using Type = HeaderField<96, 16>;
+using Layout = HeaderLayout<EthernetHeader::LENGTH, Dst, Src, Type>;
+} // namespace
+
 //! \returns A string with a textual representation of an Ethernet address
 string to_string( const EthernetAddress address )
 {
@@ -43,32 +51,18 @@ string EthernetHeader::to_string() const
 
 void EthernetHeader::parse( Parser& parser )
 {
-  // read destination address
-  for ( auto& b : dst ) {
-    parser.integer( b );
-  }
-
-  // read source address
-  for ( auto& b : src ) {
-    parser.integer( b );
-  }
-
-  // read frame type (e.g. IPv4, ARP, or something else)
-  parser.integer( type );
+  Layout::read( parser, [&]( const char* raw ) {
+    dst = Dst::get( raw );
+    src = Src::get( raw );
+    type = Type::get( raw ); // frame type (e.g. IPv4, ARP, or something else)
+  } );
 }
 
 void EthernetHeader::serialize( Serializer& serializer ) const
 {
-  // write destination address
-  for ( const auto& b : dst ) {
-    serializer.integer( b );
-  }
-
-  // write source address
-  for ( const auto& b : src ) {
-    serializer.integer( b );
-  }
-
-  // write frame type (e.g. IPv4, ARP, or something else)
-  serializer.integer( type );
+  Layout::write( serializer, [&]( char* raw ) {
+    Dst::set( raw, dst );
+    Src::set( raw, src );
+    Type::set( raw, type );
+  } );
 }
@@ -0,0 +1,29 @@
+#include "eventfd.hh"
+#include "exception.hh"
+
+#include <sys/eventfd.h>
+
+using namespace std;
+
+EventFD::EventFD( const bool semaphore )
+  : FileDescriptor( ::CheckSystemCall( "eventfd",
+                                       ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC | ( semaphore ? EFD_SEMAPHORE : 0 ) ) ) )
+{}
+
+void EventFD::notify()
+{
+  const uint64_t one = 1;
+  write( { reinterpret_cast<const char*>( &one ), sizeof( one ) } ); // NOLINT(*-reinterpret-cast)
+}
+
+uint64_t EventFD::drain()
+{
+  string buffer( sizeof( uint64_t ), 0 );
+  read( buffer );
+  if ( buffer.size() != sizeof( uint64_t ) ) {
+    return 0;
+  }
+  uint64_t count {};
+  buffer.copy( reinterpret_cast<char*>( &count ), sizeof( count ) ); // NOLINT(*-reinterpret-cast)
+  return count;
+}
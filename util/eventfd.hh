@@ -0,0 +1,21 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstdint>
+
+//! A FileDescriptor to a Linux [eventfd](\ref man2::eventfd), used to wake up a thread blocked in poll
+class EventFD : public FileDescriptor
+{
+public:
+  //! Create a non-blocking eventfd with a counter of zero
+  //! \param[in] semaphore is `true` if each drain() should consume only a single notification
+  explicit EventFD( bool semaphore = false );
+
+  //! Add one to the counter, making the fd readable
+  void notify();
+
+  //! Reset the counter to zero (or, in semaphore mode, decrement it by one)
+  //! \returns the number of notifications consumed (zero if none were pending)
+  uint64_t drain();
+};
@@ -78,9 +78,17 @@ void EventLoop::RuleHandle::cancel()
   }
 }
 
+EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
+{
+  if ( timeout_ms < 0 ) {
+    return wait_next_event( nullopt );
+  }
+  return wait_next_event( chrono::milliseconds { timeout_ms } );
+}
+
 // NOLINTBEGIN(*-cognitive-complexity)
 // NOLINTBEGIN(*-signed-bitwise)
-EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
+EventLoop::Result EventLoop::wait_next_event( const optional<chrono::nanoseconds> timeout )
 {
   // first, handle the non-file-descriptor-related rules
   {
@@ -158,7 +166,19 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
   }
 
   // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
-  if ( 0 == CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), timeout_ms ) ) ) {
+  timespec timeout_ts {};
+  if ( timeout.has_value() ) {
+    const auto nonnegative = max( timeout.value(), chrono::nanoseconds::zero() );
+    const auto seconds = chrono::duration_cast<chrono::seconds>( nonnegative );
+    timeout_ts.tv_sec = seconds.count();
+    timeout_ts.tv_nsec = ( nonnegative - seconds ).count();
+  }
+  if ( 0
+       == CheckSystemCall( "ppoll",
+                           ::ppoll( pollfds.data(),
+                                    pollfds.size(),
+                                    timeout.has_value() ? &timeout_ts : nullptr,
+                                    nullptr ) ) ) {
     return Result::Timeout;
   }
 
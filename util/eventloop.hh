@@ -1,8 +1,10 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <list>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <poll.h>
 #include <string_view>
@@ -98,8 +100,13 @@ public:
     const InterestT& interest = [] { return true; } );
 
   //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+  //! A negative timeout_ms waits indefinitely.
   Result wait_next_event( int timeout_ms );
 
+  //! Calls [ppoll(2)](\ref man2::ppoll) with a timeout of nanosecond resolution (empty waits indefinitely),
+  //! and then executes callback for each ready fd.
+  Result wait_next_event( std::optional<std::chrono::nanoseconds> timeout );
+
   // convenience function to add category and rule at the same time
   template<typename... Targs>
   auto add_rule( const std::string& name, Targs&&... Fargs )
@@ -6,6 +6,7 @@
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 
+#include <chrono>
 #include <optional>
 #include <utility>
 
@@ -14,8 +15,9 @@
 class FdAdapterBase
 {
 private:
-  FdAdapterConfig _cfg {}; //!< Configuration values
-  bool _listen = false;    //!< Is the connected TCP FSM in listen state?
+  FdAdapterConfig _cfg {};                                  //!< Configuration values
+  bool _listen = false;                                     //!< Is the connected TCP FSM in listen state?
+  ChecksumPolicy _checksum_policy = ChecksumPolicy::Verify; //!< How to treat checksums of received segments
 
 protected:
   FdAdapterConfig& config_mutable() { return _cfg; }
@@ -29,6 +31,16 @@ public:
   //! \returns whether the FdAdapter is listening for a new connection
   bool listening() const { return _listen; }
 
+  //! \brief Declare how far the path to this adapter can be trusted not to corrupt segments
+  //! \details Under ChecksumPolicy::Trust, the adapter neither computes checksums of the segments it sends nor
+  //! verifies those it receives, so both ends of the path must share the policy.
+  //! \param[in] policy is the new policy
+  void set_checksum_policy( const ChecksumPolicy policy ) { _checksum_policy = policy; }
+
+  //! \brief Get the checksum policy
+  //! \returns how the adapter treats checksums (see ChecksumPolicy)
+  ChecksumPolicy checksum_policy() const { return _checksum_policy; }
+
   //! \brief Get the current configuration
   //! \returns a const reference
   const FdAdapterConfig& config() const { return _cfg; }
@@ -38,5 +50,9 @@ public:
   FdAdapterConfig& config_mut() { return _cfg; }
 
   //! Called periodically when time elapses
-  void tick( const size_t unused [[maybe_unused]] ) {}
+  void tick( const std::chrono::microseconds unused [[maybe_unused]] ) {}
+
+  //! \brief How long until tick() next has work to do
+  //! \returns time until the next timer expires, or empty if the adapter keeps no timers
+  std::optional<std::chrono::microseconds> next_timeout() const { return {}; }
 };
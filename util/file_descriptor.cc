@@ -166,6 +166,16 @@ size_t FileDescriptor::write( const vector<std::string>& buffers )
   return write( views );
 }
 
+size_t FileDescriptor::write( const vector<Buffer>& buffers )
+{
+  vector<string_view> views;
+  views.reserve( buffers.size() );
+  for ( const auto& x : buffers ) {
+    views.push_back( x );
+  }
+  return write( views );
+}
+
 size_t FileDescriptor::write( const vector<string_view>& buffers )
 {
   vector<iovec> iovecs;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "buffer.hh"
+
 #include <cstddef>
 #include <limits>
 #include <memory>
@@ -70,6 +72,7 @@ public:
   size_t write( std::string_view buffer );
   size_t write( const std::vector<std::string_view>& buffers );
   size_t write( const std::vector<std::string>& buffers );
+  size_t write( const std::vector<Buffer>& buffers );
 
   // Close the underlying file descriptor
   void close() { internal_fd_->close(); }
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "parser.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Compile-time descriptions of fixed-length header layouts, from which straight-line encode and decode code is
+// generated. A header describes each of its fields with a HeaderField (an integer of up to 32 bits, at any bit
+// offset, e.g. the 4-bit version in the first byte of an IPv4 header) or a HeaderBytes (a byte string, e.g. an
+// Ethernet address), and gathers them into a HeaderLayout, which checks at compile time that they lie within
+// the header and don't overlap. Reading a header through its layout checks the input's length once, and then
+// decodes each field with a single load (and shift and mask) at a constant offset; writing it is the reverse.
+
+// A `WIDTH`-bit big-endian unsigned integer, starting `BIT_OFFSET` bits into the header (counting from the
+// most significant bit of the first byte, as the diagrams in the RFCs do)
+template<size_t BIT_OFFSET, size_t WIDTH>
+struct HeaderField
+{
+  static_assert( WIDTH > 0 and WIDTH <= 32, "HeaderField: width must be between 1 and 32 bits" );
+
+  static constexpr size_t BEGIN_BIT = BIT_OFFSET;
+  static constexpr size_t END_BIT = BIT_OFFSET + WIDTH;
+
+  // The smallest integer type that can hold the field's value
+  using value_type = std::conditional_t<WIDTH <= 8, uint8_t, std::conditional_t<WIDTH <= 16, uint16_t, uint32_t>>;
+
+private:
+  static constexpr size_t FIRST_BYTE = BIT_OFFSET / 8;
+  static constexpr size_t SPAN = ( END_BIT + 7 ) / 8 - FIRST_BYTE; // bytes the field touches
+
+  // The field is read (and written) as the smallest integer that covers those bytes
+  using word_type = std::conditional_t<
+    SPAN == 1,
+    uint8_t,
+    std::conditional_t<SPAN == 2, uint16_t, std::conditional_t<SPAN <= 4, uint32_t, uint64_t>>>;
+
+  static constexpr size_t WORD_BITS = sizeof( word_type ) * 8;
+  static constexpr size_t SHIFT = WORD_BITS - BIT_OFFSET % 8 - WIDTH;
+  static constexpr word_type MASK = static_cast<word_type>( ( ( uint64_t { 1 } << WIDTH ) - 1 ) << SHIFT );
+  static constexpr bool WHOLE_WORD = WIDTH == WORD_BITS;
+
+public:
+  // Bytes of the header that decoding (or encoding) the field reads
+  static constexpr size_t END_BYTE = FIRST_BYTE + sizeof( word_type );
+
+  static value_type get( const char* header )
+  {
+    const auto word = load_big_endian<word_type>( header + FIRST_BYTE );
+    if constexpr ( WHOLE_WORD ) {
+      return word;
+    } else {
+      return static_cast<value_type>( ( word & MASK ) >> SHIFT );
+    }
+  }
+
+  // Store the value (truncated to the field's width), leaving any other fields that share its bytes unchanged
+  static void set( char* header, const value_type value )
+  {
+    if constexpr ( WHOLE_WORD ) {
+      store_big_endian( header + FIRST_BYTE, value );
+    } else {
+      const auto word = load_big_endian<word_type>( header + FIRST_BYTE );
+      const auto field = static_cast<word_type>( static_cast<word_type>( value ) << SHIFT );
+      store_big_endian( header + FIRST_BYTE, static_cast<word_type>( ( word & ~MASK ) | ( field & MASK ) ) );
+    }
+  }
+};
+
+// A string of `LENGTH` bytes, starting `BYTE_OFFSET` bytes into the header
+template<size_t BYTE_OFFSET, size_t LENGTH>
+struct HeaderBytes
+{
+  static constexpr size_t BEGIN_BIT = BYTE_OFFSET * 8;
+  static constexpr size_t END_BIT = ( BYTE_OFFSET + LENGTH ) * 8;
+  static constexpr size_t END_BYTE = BYTE_OFFSET + LENGTH;
+
+  using value_type = std::array<uint8_t, LENGTH>;
+
+  static value_type get( const char* header )
+  {
+    value_type ret;
+    std::memcpy( ret.data(), header + BYTE_OFFSET, LENGTH );
+    return ret;
+  }
+
+  static void set( char* header, const value_type& value )
+  {
+    std::memcpy( header + BYTE_OFFSET, value.data(), LENGTH );
+  }
+};
+
+// A fixed-length header of `LENGTH_` bytes, made up of `Fields` (any bits they don't cover are written as zero)
+template<size_t LENGTH_, class... Fields>
+struct HeaderLayout
+{
+  static constexpr size_t LENGTH = LENGTH_;
+
+  static_assert( ( ( Fields::END_BYTE <= LENGTH ) and ... ), "HeaderLayout: field extends past end of header" );
+
+private:
+  static constexpr bool fields_overlap()
+  {
+    constexpr std::array<size_t, sizeof...( Fields )> begin { Fields::BEGIN_BIT... };
+    constexpr std::array<size_t, sizeof...( Fields )> end { Fields::END_BIT... };
+    for ( size_t i = 0; i < begin.size(); ++i ) {
+      for ( size_t j = i + 1; j < begin.size(); ++j ) {
+        if ( begin.at( i ) < end.at( j ) and begin.at( j ) < end.at( i ) ) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  static_assert( not fields_overlap(), "HeaderLayout: fields overlap" );
+
+public:
+  // Pass the header's bytes to `decode` (in place if they lie within one input buffer, or else gathered into a
+  // local copy), and consume them. If the input is too short, sets the parser's error instead.
+  template<class Decoder>
+  static void read( Parser& parser, Decoder&& decode )
+  {
+    const auto raw = parser.contiguous( LENGTH );
+    if ( raw.has_value() ) {
+      decode( raw->data() );
+      parser.remove_prefix( LENGTH ); // may free the buffer `raw` points into
+      return;
+    }
+
+    std::array<char, LENGTH> copy {};
+    parser.string( copy );
+    if ( not parser.has_error() ) {
+      decode( copy.data() );
+    }
+  }
+
+  // Append the header to the serializer's output, as filled in by `encode` (starting from all zeros)
+  template<class Encoder>
+  static void write( Serializer& serializer, Encoder&& encode )
+  {
+    encode( serializer.append( LENGTH ) );
+  }
+};
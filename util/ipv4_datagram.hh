@@ -1,5 +1,6 @@
 #pragma once
 
+#include "buffer.hh"
 #include "ipv4_header.hh"
 #include "parser.hh"
 
@@ -11,7 +12,12 @@
 struct IPv4Datagram
 {
   IPv4Header header {};
-  std::vector<std::string> payload {};
+  std::vector<Buffer> payload {};
+
+  //! The whole datagram as it was received, if it came in one Buffer (which `payload` is then a slice of).
+  //! It lets a router forward the received bytes, with just the header rewritten, rather than serializing a copy,
+  //! for as long as `payload` is still that slice. (Code that replaces the payload should reset it as well.)
+  Buffer wire {};
 
   void parse( Parser& parser )
   {
@@ -19,12 +25,16 @@ struct IPv4Datagram
     parser.all_remaining( payload );
   }
 
-  void serialize( Serializer& serializer ) const
+  void serialize( Serializer& serializer ) const&
+  {
+    header.serialize( serializer );
+    serializer.buffer( payload );
+  }
+
+  void serialize( Serializer& serializer ) &&
   {
     header.serialize( serializer );
-    for ( const auto& x : payload ) {
-      serializer.buffer( x );
-    }
+    serializer.buffer( std::move( payload ) );
   }
 };
 
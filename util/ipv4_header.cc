@@ -1,5 +1,6 @@
 #include "ipv4_header.hh"
 #include "checksum.hh"
+#include "header_codec.hh"
 
 #include <arpa/inet.h>
 #include <array>
@@ -8,28 +9,60 @@
 
 using namespace std;
 
+namespace {
+using Version = HeaderField<0, 4>;
+using HeaderLength = HeaderField<4, 4>;
+using TypeOfService = HeaderField<8, 8>;
+using TotalLength = HeaderField<16, 16>;
+using Identification = HeaderField<32, 16>;
+using DontFragment = HeaderField<49, 1>;
+using MoreFragments = HeaderField<50, 1>;
+using FragmentOffset = HeaderField<51, 13>;
+using TimeToLive = HeaderField<64, 8>;
+using Protocol = HeaderField<72, 8>;
+using Checksum = HeaderField<80, 16>;
+using Source = HeaderField<96, 32>;
+using Destination = HeaderField<128, 32>;
+using Layout = HeaderLayout<IPv4Header::LENGTH,
+                            Version,
+                            HeaderLength,
+                            TypeOfService,
+                            TotalLength,
+                            Identification,
+                            DontFragment,
+                            MoreFragments,
+                            FragmentOffset,
+                            TimeToLive,
+                            Protocol,
+                            Checksum,
+                            Source,
+                            Destination>;
+} // namespace
+
 // Parse from string.
 void IPv4Header::parse( Parser& parser )
 {
-  uint8_t first_byte {};
-  parser.integer( first_byte );
-  ver = first_byte >> 4;    // version
-  hlen = first_byte & 0x0f; // header length
-  parser.integer( tos );    // type of service
-  parser.integer( len );
-  parser.integer( id );
-
-  uint16_t fo_val {};
-  parser.integer( fo_val );
-  df = static_cast<bool>( fo_val & 0x4000 ); // don't fragment
-  mf = static_cast<bool>( fo_val & 0x2000 ); // more fragments
-  offset = fo_val & 0x1fff;                  // offset
-
-  parser.integer( ttl );
-  parser.integer( proto );
-  parser.integer( cksum );
-  parser.integer( src );
-  parser.integer( dst );
+  // read the fixed-length header, and sum it while its bytes are at hand
+  bool raw_checksum_ok = false;
+  Layout::read( parser, [&]( const char* raw ) {
+    ver = Version::get( raw );
+    hlen = HeaderLength::get( raw );
+    tos = TypeOfService::get( raw );
+    len = TotalLength::get( raw );
+    id = Identification::get( raw );
+    df = DontFragment::get( raw );
+    mf = MoreFragments::get( raw );
+    offset = FragmentOffset::get( raw );
+    ttl = TimeToLive::get( raw );
+    proto = Protocol::get( raw );
+    cksum = Checksum::get( raw );
+    src = Source::get( raw );
+    dst = Destination::get( raw );
+
+    InternetChecksum check;
+    check.add( string_view { raw, LENGTH } );
+    raw_checksum_ok = check.value() == 0;
+  } );
 
   if ( ver != 4 ) {
     parser.set_error();
@@ -45,7 +78,14 @@ void IPv4Header::parse( Parser& parser )
 
   parser.remove_prefix( static_cast<uint64_t>( hlen ) * 4 - IPv4Header::LENGTH );
 
-  // Verify checksum
+  // Verify checksum (without reserializing the header, if it has no options and so was summed already)
+  if ( hlen * 4 == LENGTH ) {
+    if ( not raw_checksum_ok ) {
+      parser.set_error();
+    }
+    return;
+  }
+
   const uint16_t given_cksum = cksum;
   compute_checksum();
   if ( cksum != given_cksum ) {
@@ -55,28 +95,30 @@ void IPv4Header::parse( Parser& parser )
 
 // Serialize the IPv4Header (does not recompute the checksum)
 void IPv4Header::serialize( Serializer& serializer ) const
+{
+  Layout::write( serializer, [&]( char* raw ) { encode( raw ); } );
+}
+
+void IPv4Header::encode( char* raw ) const
 {
   // consistency checks
   if ( ver != 4 ) {
     throw runtime_error( "wrong IP version" );
   }
 
-  const uint8_t first_byte = ( static_cast<uint32_t>( ver ) << 4 ) | ( hlen & 0xfU );
-  serializer.integer( first_byte ); // version and header length
-  serializer.integer( tos );
-  serializer.integer( len );
-  serializer.integer( id );
-
-  const uint16_t fo_val = ( df ? 0x4000U : 0 ) | ( mf ? 0x2000U : 0 ) | ( offset & 0x1fffU );
-  serializer.integer( fo_val );
-
-  serializer.integer( ttl );
-  serializer.integer( proto );
-
-  serializer.integer( cksum );
-
-  serializer.integer( src );
-  serializer.integer( dst );
+  Version::set( raw, ver );
+  HeaderLength::set( raw, hlen );
+  TypeOfService::set( raw, tos );
+  TotalLength::set( raw, len );
+  Identification::set( raw, id );
+  DontFragment::set( raw, df );
+  MoreFragments::set( raw, mf );
+  FragmentOffset::set( raw, offset );
+  TimeToLive::set( raw, ttl );
+  Protocol::set( raw, proto );
+  Checksum::set( raw, cksum );
+  Source::set( raw, src );
+  Destination::set( raw, dst );
 }
 
 uint16_t IPv4Header::payload_length() const
@@ -107,15 +149,28 @@ uint32_t IPv4Header::pseudo_checksum() const
 void IPv4Header::compute_checksum()
 {
   cksum = 0;
-  Serializer s;
-  serialize( s );
+  array<char, LENGTH> raw {};
+  encode( raw.data() );
 
   // calculate checksum -- taken over header only
   InternetChecksum check;
-  check.add( s.output() );
+  check.add( string_view { raw.data(), raw.size() } );
   cksum = check.value();
 }
 
+void IPv4Header::decrement_ttl()
+{
+  if ( ttl == 0 ) {
+    return;
+  }
+
+  // the TTL shares its 16-bit word with the protocol
+  const auto ttl_proto_word = [&] { return static_cast<uint16_t>( ttl << 8 | proto ); };
+  const uint16_t old_word = ttl_proto_word();
+  --ttl;
+  cksum = InternetChecksum::adjust( cksum, old_word, ttl_proto_word() );
+}
+
 std::string IPv4Header::to_string() const
 {
   stringstream ss {};
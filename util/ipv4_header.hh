@@ -57,9 +57,16 @@ struct IPv4Header
   // Set checksum to correct value
   void compute_checksum();
 
+  // Decrement the TTL (unless it is already zero), updating the checksum incrementally
+  void decrement_ttl();
+
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
   void parse( Parser& parser );
   void serialize( Serializer& serializer ) const;
+
+  // Write the fixed-length part of the header over `LENGTH` bytes (e.g. of a header as received, to edit it in
+  // place: options that follow, and the reserved flag bit, are left as they were)
+  void encode( char* raw ) const;
 };
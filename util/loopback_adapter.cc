@@ -0,0 +1,116 @@
+#include "loopback_adapter.hh"
+#include "parser.hh"
+
+using namespace std;
+
+pair<LoopbackAdapter, LoopbackAdapter> LoopbackAdapter::make_pair( const bool serialize_ipv4,
+                                                                   const ChecksumPolicy checksum )
+{
+  auto a_to_b = make_shared<Channel>();
+  auto b_to_a = make_shared<Channel>();
+  return { LoopbackAdapter { b_to_a, a_to_b, serialize_ipv4, checksum },
+           LoopbackAdapter { a_to_b, b_to_a, serialize_ipv4, checksum } };
+}
+
+LoopbackAdapter::LoopbackAdapter( shared_ptr<Channel> inbound,
+                                  shared_ptr<Channel> outbound,
+                                  bool serialize_ipv4,
+                                  const ChecksumPolicy checksum )
+  : inbound_( move( inbound ) ), outbound_( move( outbound ) ), serialize_ipv4_( serialize_ipv4 )
+{
+  set_checksum_policy( checksum );
+}
+
+optional<TCPMessage> LoopbackAdapter::read()
+{
+  auto dgram = inbound_->pop();
+  if ( not dgram.has_value() ) {
+    return {};
+  }
+
+  if ( auto* msg = get_if<TCPMessage>( &dgram.value() ) ) {
+    // a listening adapter learns its peer from the first SYN, just like TCPOverIPv4Adapter
+    if ( listening() ) {
+      if ( not msg->sender.SYN or msg->sender.RST ) {
+        return {};
+      }
+      set_listening( false );
+    }
+    return move( *msg );
+  }
+
+  InternetDatagram ip_dgram;
+  if ( parse( ip_dgram, std::move( get<vector<Buffer>>( dgram.value() ) ) ) ) {
+    return unwrap_tcp_in_ip( std::move( ip_dgram ) );
+  }
+  return {};
+}
+
+// The two ends of a pair usually run in different threads. Handing over a payload that the sender still
+// references (to retransmit it) would make both threads contend on its reference count, so the other end gets
+// its own copy instead, which its receiver can then take over without copying it again.
+void LoopbackAdapter::write( const TCPMessage& msg )
+{
+  if ( serialize_ipv4_ ) {
+    auto wire = serialize( wrap_tcp_in_ip( msg ) );
+    for ( auto& buf : wire ) {
+      buf.unshare();
+    }
+    outbound_->push( move( wire ) );
+  } else {
+    TCPMessage copy = msg;
+    copy.sender.payload.unshare();
+    outbound_->push( move( copy ) );
+  }
+}
+
+bool LoopbackAdapter::readable() const
+{
+  return not inbound_->empty();
+}
+
+FileDescriptor& LoopbackAdapter::fd()
+{
+  return inbound_->fd();
+}
+
+void LoopbackAdapter::Channel::push( Datagram&& dgram )
+{
+  const lock_guard lock { mutex_ };
+  queue_.push_back( move( dgram ) );
+  if ( notify_.has_value() ) {
+    notify_->notify();
+  }
+}
+
+optional<LoopbackAdapter::Channel::Datagram> LoopbackAdapter::Channel::pop()
+{
+  const lock_guard lock { mutex_ };
+  if ( queue_.empty() ) {
+    return {};
+  }
+  auto dgram = move( queue_.front() );
+  queue_.pop_front();
+  if ( notify_.has_value() ) {
+    notify_->drain();
+  }
+  return dgram;
+}
+
+bool LoopbackAdapter::Channel::empty() const
+{
+  const lock_guard lock { mutex_ };
+  return queue_.empty();
+}
+
+FileDescriptor& LoopbackAdapter::Channel::fd()
+{
+  const lock_guard lock { mutex_ };
+  if ( not notify_.has_value() ) {
+    notify_.emplace( true );
+    for ( size_t i = 0; i < queue_.size(); ++i ) {
+      notify_->notify();
+    }
+  }
+  return notify_.value();
+}
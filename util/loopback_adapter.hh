@@ -0,0 +1,76 @@
+#pragma once
+
+#include "eventfd.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "tuntap_adapter.hh"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+//! \brief An in-process datagram adapter that needs no TUN device or privileges
+//! \details LoopbackAdapter::make_pair() returns two adapters connected back to back: whatever one
+//! writes, the other reads. The messages travel through a queue shared between them, so both
+//! ends can run in the same thread (e.g. two TCPPeers driven by a benchmark loop) or in different
+//! threads (e.g. two TCPMinnowSockets).
+//!
+//! By default, TCPMessages are passed through as-is. If the pair is made with `serialize_ipv4`,
+//! each message is instead wrapped in an IPv4 datagram and serialized to bytes, then parsed and
+//! filtered on the other side, exactly as it would be on its way through a TUN device. Nothing on the way can
+//! corrupt the bytes, though, so by default the pair trusts them, and neither computes nor verifies TCP
+//! checksums (see ChecksumPolicy), much as a NIC with checksum offload would.
+class LoopbackAdapter : public TCPOverIPv4Adapter
+{
+public:
+  //! Create two adapters connected to each other
+  static std::pair<LoopbackAdapter, LoopbackAdapter> make_pair( bool serialize_ipv4 = false,
+                                                                ChecksumPolicy checksum = ChecksumPolicy::Trust );
+
+  //! Take the next inbound message, if any
+  std::optional<TCPMessage> read();
+
+  //! Send a message to the other adapter of the pair
+  void write( const TCPMessage& msg );
+
+  //! Is an inbound message waiting to be read?
+  bool readable() const;
+
+  //! \brief A file descriptor that is readable while inbound messages are waiting
+  //! \details Created on first use, so adapters driven without an EventLoop make no system calls
+  FileDescriptor& fd();
+
+private:
+  //! One direction of the pair
+  class Channel
+  {
+  public:
+    using Datagram = std::variant<TCPMessage, std::vector<Buffer>>;
+
+    void push( Datagram&& dgram );
+    std::optional<Datagram> pop();
+    bool empty() const;
+    FileDescriptor& fd();
+
+  private:
+    mutable std::mutex mutex_ {};
+    std::deque<Datagram> queue_ {};
+    std::optional<EventFD> notify_ {}; //!< counts queued datagrams once someone is polling for them
+  };
+
+  LoopbackAdapter( std::shared_ptr<Channel> inbound,
+                   std::shared_ptr<Channel> outbound,
+                   bool serialize_ipv4,
+                   ChecksumPolicy checksum );
+
+  std::shared_ptr<Channel> inbound_;
+  std::shared_ptr<Channel> outbound_;
+  bool serialize_ipv4_;
+};
+
+static_assert( TCPDatagramAdapter<LoopbackAdapter> );
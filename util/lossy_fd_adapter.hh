@@ -5,6 +5,7 @@
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 
+#include <chrono>
 #include <optional>
 #include <random>
 #include <utility>
@@ -65,5 +66,6 @@ public:
   void set_listening( const bool l ) { _adapter.set_listening( l ); } //!< FdAdapterBase::set_listening passthrough
   const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
   FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
-  void tick( const size_t ms_since_last_tick ) { _adapter.tick( ms_since_last_tick ); }
+  void tick( const std::chrono::microseconds t ) { _adapter.tick( t ); } //!< FdAdapterBase::tick passthrough
+  std::optional<std::chrono::microseconds> next_timeout() const { return _adapter.next_timeout(); } //!< passthrough
 };
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "file_descriptor.hh"
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <optional>
+#include <random>
+#include <utility>
+
+//! \brief An adapter class that emulates a network path (in the style of Linux's netem) in front of an FD adapter
+//! \details Each direction has its own NetemConfig (FdAdapterConfig::netem_up for writes and
+//! FdAdapterConfig::netem_dn for reads). A datagram first passes a Gilbert-Elliott loss model, then
+//! waits in a rate-limited bottleneck queue of bounded depth, then spends the propagation delay
+//! (plus jitter) on the "wire". A reordered datagram skips the propagation delay and overtakes the
+//! datagrams ahead of it.
+//!
+//! Time only moves when tick() is called. Datagrams that come due are written to the underlying
+//! adapter by tick(); inbound datagrams that come due are returned by read() or read_delayed().
+template<typename AdapterT>
+class NetemFdAdapter
+{
+private:
+  //! One direction of the emulated path
+  class Link
+  {
+  public:
+    //! \brief Admit a datagram to this direction of the path (or drop it)
+    //! \returns `false` if the datagram was dropped
+    bool send( TCPMessage&& msg,
+               const NetemConfig& cfg,
+               const std::chrono::microseconds now,
+               std::default_random_engine& rand )
+    {
+      if ( lost( cfg, rand ) ) {
+        return false;
+      }
+
+      // bottleneck: serialize at the configured rate, behind whatever is already queued
+      auto departure = now;
+      if ( cfg.rate != 0 ) {
+        while ( not bottleneck_.empty() and bottleneck_.front() <= now ) {
+          bottleneck_.pop_front();
+        }
+        if ( cfg.queue_limit != 0 and bottleneck_.size() >= cfg.queue_limit ) {
+          return false;
+        }
+        const uint64_t wire_bytes = IPV4_TCP_HEADERS_LENGTH + msg.sender.payload.size();
+        departure = std::max( now, bottleneck_.empty() ? now : bottleneck_.back() )
+                    + std::chrono::microseconds { wire_bytes * 1'000'000 / cfg.rate };
+        bottleneck_.push_back( departure );
+      }
+
+      // propagation delay (unless the datagram gets reordered ahead of the others)
+      auto arrival = departure;
+      if ( not chance( cfg.reorder_rate, rand ) ) {
+        auto delay = cfg.delay;
+        if ( cfg.jitter.count() > 0 ) {
+          delay += std::chrono::microseconds {
+            std::uniform_int_distribution<int64_t> { -cfg.jitter.count(), cfg.jitter.count() }( rand ) };
+        }
+        arrival += std::max( delay, std::chrono::microseconds::zero() );
+      }
+
+      in_flight_.emplace( arrival, std::move( msg ) );
+      return true;
+    }
+
+    //! Take the earliest datagram whose arrival time has come, if any
+    std::optional<TCPMessage> receive( const std::chrono::microseconds now )
+    {
+      if ( in_flight_.empty() or in_flight_.begin()->first > now ) {
+        return {};
+      }
+      auto msg = std::move( in_flight_.begin()->second );
+      in_flight_.erase( in_flight_.begin() );
+      return msg;
+    }
+
+    //! Time until the next datagram arrives, if any are in flight
+    std::optional<std::chrono::microseconds> next_arrival( const std::chrono::microseconds now ) const
+    {
+      if ( in_flight_.empty() ) {
+        return {};
+      }
+      return std::max( in_flight_.begin()->first - now, std::chrono::microseconds::zero() );
+    }
+
+  private:
+    static constexpr uint64_t IPV4_TCP_HEADERS_LENGTH = 40; //!< bytes a datagram occupies beyond its payload
+
+    std::multimap<std::chrono::microseconds, TCPMessage> in_flight_ {}; //!< datagrams keyed by arrival time
+    std::deque<std::chrono::microseconds> bottleneck_ {}; //!< departure times of datagrams still queued
+    bool bad_state_ {};                                    //!< Gilbert-Elliott channel state
+
+    static bool chance( const uint16_t rate, std::default_random_engine& rand )
+    {
+      return rate != 0 && static_cast<uint16_t>( rand() ) < rate;
+    }
+
+    bool lost( const NetemConfig& cfg, std::default_random_engine& rand )
+    {
+      if ( chance( bad_state_ ? cfg.bad_to_good : cfg.good_to_bad, rand ) ) {
+        bad_state_ = not bad_state_;
+      }
+      return chance( bad_state_ ? cfg.loss_bad : cfg.loss_good, rand );
+    }
+  };
+
+  //! Fast RNG used for loss, jitter and reordering
+  std::default_random_engine _rand { get_random_engine() };
+
+  //! The underlying FD adapter
+  AdapterT _adapter;
+
+  //! Emulated time, advanced by tick()
+  std::chrono::microseconds _now {};
+
+  Link _uplink {};   //!< datagrams written by the TCP connection, on their way to the underlying adapter
+  Link _downlink {}; //!< datagrams read from the underlying adapter, on their way to the TCP connection
+
+  //! Write every uplink datagram that has come due to the underlying adapter
+  void _flush_uplink()
+  {
+    while ( auto msg = _uplink.receive( _now ) ) {
+      _adapter.write( msg.value() );
+    }
+  }
+
+public:
+  //! Conversion to a FileDescriptor by returning the underlying AdapterT
+  FileDescriptor& fd() { return _adapter.fd(); }
+
+  //! Construct from a FileDescriptor appropriate to the AdapterT constructor
+  explicit NetemFdAdapter( AdapterT&& adapter ) : _adapter( std::move( adapter ) ) {}
+
+  //! Construct with a given random engine for loss, jitter and reordering (so that a test can repeat exactly)
+  NetemFdAdapter( AdapterT&& adapter, std::default_random_engine rand )
+    : _rand( std::move( rand ) ), _adapter( std::move( adapter ) )
+  {}
+
+  //! \brief Read from the underlying AdapterT instance and send the datagram along the downlink
+  //! \returns std::optional<TCPMessage> with the earliest downlink datagram that has come due, if any
+  std::optional<TCPMessage> read()
+  {
+    if ( auto msg = _adapter.read() ) {
+      _downlink.send( std::move( msg.value() ), config().netem_dn, _now, _rand );
+    }
+    return _downlink.receive( _now );
+  }
+
+  //! \brief Take a downlink datagram that has come due, without reading from the underlying adapter
+  //! \details Use this when delayed datagrams are waiting (see has_delayed_read()) but the underlying
+  //! file descriptor is not readable.
+  std::optional<TCPMessage> read_delayed() { return _downlink.receive( _now ); }
+
+  //! Is a downlink datagram due to be read?
+  bool has_delayed_read() const { return _downlink.next_arrival( _now ) == std::chrono::microseconds::zero(); }
+
+  //! \brief Send a datagram along the uplink; it reaches the underlying AdapterT once it comes due
+  //! \param[in] seg is the packet to emulate sending
+  void write( const TCPMessage& seg )
+  {
+    TCPMessage copy = seg;
+    _uplink.send( std::move( copy ), config().netem_up, _now, _rand );
+    _flush_uplink();
+  }
+
+  //! Advance emulated time, delivering any uplink datagrams that come due
+  void tick( const std::chrono::microseconds t )
+  {
+    _now += t;
+    _adapter.tick( t );
+    _flush_uplink();
+  }
+
+  //! Time until the next datagram comes due in either direction (or the underlying adapter's next timer)
+  std::optional<std::chrono::microseconds> next_timeout() const
+  {
+    std::optional<std::chrono::microseconds> ret = _adapter.next_timeout();
+    for ( const auto t : { _uplink.next_arrival( _now ), _downlink.next_arrival( _now ) } ) {
+      if ( t.has_value() ) {
+        ret = std::min( ret.value_or( t.value() ), t.value() );
+      }
+    }
+    return ret;
+  }
+
+  //! \name
+  //! Passthrough functions to the underlying AdapterT instance
+
+  void set_listening( const bool l ) { _adapter.set_listening( l ); } //!< FdAdapterBase::set_listening passthrough
+  const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
+  FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
+};
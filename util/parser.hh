@@ -1,33 +1,85 @@
 #pragma once
 
+#include "buffer.hh"
+
 #include <algorithm>
+#include <bit>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
 #include <deque>
 #include <numeric>
+#include <optional>
 #include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
+// Load a big-endian integer from `data` (which need not be aligned)
+template<std::unsigned_integral T>
+T load_big_endian( const char* data )
+{
+  T val {};
+  std::memcpy( &val, data, sizeof( T ) );
+  if constexpr ( std::endian::native == std::endian::little ) {
+    if constexpr ( sizeof( T ) == 2 ) {
+      val = __builtin_bswap16( val );
+    } else if constexpr ( sizeof( T ) == 4 ) {
+      val = __builtin_bswap32( val );
+    } else if constexpr ( sizeof( T ) == 8 ) {
+      val = __builtin_bswap64( val );
+    }
+  }
+  return val;
+}
+
+// Store `val` as a big-endian integer at `data` (which need not be aligned)
+template<std::unsigned_integral T>
+void store_big_endian( char* data, T val )
+{
+  if constexpr ( std::endian::native == std::endian::little ) {
+    if constexpr ( sizeof( T ) == 2 ) {
+      val = __builtin_bswap16( val );
+    } else if constexpr ( sizeof( T ) == 4 ) {
+      val = __builtin_bswap32( val );
+    } else if constexpr ( sizeof( T ) == 8 ) {
+      val = __builtin_bswap64( val );
+    }
+  }
+  std::memcpy( data, &val, sizeof( T ) );
+}
+
 class Parser
 {
   class BufferList
   {
     uint64_t size_ {};
-    std::deque<std::string> buffer_ {};
-    uint64_t skip_ {};
+    std::deque<Buffer> buffer_ {};
 
   public:
-    explicit BufferList( const std::vector<std::string>& buffers )
+    explicit BufferList( const std::vector<Buffer>& buffers )
     {
       for ( const auto& x : buffers ) {
         append( x );
       }
     }
 
+    explicit BufferList( std::vector<Buffer>&& buffers )
+    {
+      for ( auto& x : buffers ) {
+        append( std::move( x ) );
+      }
+    }
+
+    explicit BufferList( std::vector<std::string>&& buffers )
+    {
+      for ( auto& x : buffers ) {
+        append( std::move( x ) );
+      }
+    }
+
     uint64_t size() const { return size_; }
     uint64_t serialized_length() const { return size(); }
     bool empty() const { return size_ == 0; }
@@ -37,74 +89,69 @@ class Parser
       if ( buffer_.empty() ) {
         throw std::runtime_error( "peek on empty BufferList" );
       }
-      return std::string_view { buffer_.front() }.substr( skip_ );
+      return buffer_.front();
     }
 
     void remove_prefix( uint64_t len )
     {
       while ( len and not buffer_.empty() ) {
-        const uint64_t to_pop_now = std::min( len, peek().size() );
-        skip_ += to_pop_now;
+        const uint64_t to_pop_now = std::min( len, buffer_.front().size() );
+        buffer_.front().remove_prefix( to_pop_now );
         len -= to_pop_now;
         size_ -= to_pop_now;
-        if ( skip_ == buffer_.front().size() ) {
+        if ( buffer_.front().empty() ) {
           buffer_.pop_front();
-          skip_ = 0;
         }
       }
     }
 
-    void dump_all( std::vector<std::string>& out )
+    void dump_all( std::vector<Buffer>& out )
     {
       out.clear();
-      if ( empty() ) {
-        return;
-      }
-      std::string first_str = std::move( buffer_.front() );
-      if ( skip_ ) {
-        first_str = first_str.substr( skip_ );
-      }
-      out.emplace_back( std::move( first_str ) );
-      buffer_.pop_front();
       for ( auto&& x : buffer_ ) {
         out.emplace_back( std::move( x ) );
       }
+      buffer_.clear();
+      size_ = 0;
     }
 
-    void dump_all( std::string& out )
+    void dump_all( Buffer& out )
     {
-      std::vector<std::string> concat;
-      dump_all( concat );
-      if ( concat.size() == 1 ) {
-        out = std::move( concat.front() );
+      if ( buffer_.size() <= 1 ) {
+        out = buffer_.empty() ? Buffer {} : std::move( buffer_.front() );
+        buffer_.clear();
+        size_ = 0;
         return;
       }
 
-      out.clear();
-      for ( const auto& s : concat ) {
-        out.append( s );
+      // the remaining bytes span buffers, so they have to be gathered into one
+      std::string concat;
+      concat.reserve( size_ );
+      for ( const auto& x : buffer_ ) {
+        concat.append( x.view() );
       }
+      Buffer::record_copy( concat.size() );
+      out = std::move( concat );
+      buffer_.clear();
+      size_ = 0;
     }
 
     std::vector<std::string_view> buffer() const
     {
-      if ( empty() ) {
-        return {};
-      }
       std::vector<std::string_view> ret;
       ret.reserve( buffer_.size() );
-      auto tmp_skip = skip_;
       for ( const auto& x : buffer_ ) {
-        ret.push_back( std::string_view { x }.substr( tmp_skip ) );
-        tmp_skip = 0;
+        ret.push_back( x );
       }
       return ret;
     }
 
-    void append( std::string str )
+    void append( Buffer buf )
     {
-      size_ += str.size();
-      buffer_.push_back( std::move( str ) );
+      if ( not buf.empty() ) {
+        size_ += buf.size();
+        buffer_.push_back( std::move( buf ) );
+      }
     }
   };
 
@@ -119,7 +166,13 @@ class Parser
   }
 
 public:
-  explicit Parser( const std::vector<std::string>& input ) : input_( input ) {}
+  // Parsing shares the bytes of the input Buffers: all_remaining() hands what is left of them back out
+  // as slices, without copying their contents.
+  explicit Parser( const std::vector<Buffer>& input ) : input_( input ) {}
+  explicit Parser( std::vector<Buffer>&& input ) : input_( std::move( input ) ) {}
+
+  // Take ownership of the strings (e.g. just read from a file descriptor) without copying them
+  explicit Parser( std::vector<std::string>&& input ) : input_( std::move( input ) ) {}
 
   const BufferList& input() const { return input_; }
 
@@ -127,6 +180,15 @@ public:
   void set_error() { error_ = true; }
   void remove_prefix( size_t n ) { input_.remove_prefix( n ); }
 
+  // A view of the next `len` bytes if they all lie within the current buffer (nothing is consumed)
+  std::optional<std::string_view> contiguous( const size_t len ) const
+  {
+    if ( has_error() or input_.empty() or input_.peek().size() < len ) {
+      return {};
+    }
+    return input_.peek().substr( 0, len );
+  }
+
   template<std::unsigned_integral T>
   void integer( T& out )
   {
@@ -135,6 +197,14 @@ public:
       return;
     }
 
+    // fast path: the whole integer is in the current buffer
+    const auto view = input_.peek();
+    if ( view.size() >= sizeof( T ) ) {
+      out = load_big_endian<T>( view.data() );
+      input_.remove_prefix( sizeof( T ) );
+      return;
+    }
+
     if constexpr ( sizeof( T ) == 1 ) {
       out = static_cast<uint8_t>( input_.peek().front() );
       input_.remove_prefix( 1 );
@@ -164,46 +234,69 @@ public:
     }
   }
 
-  void all_remaining( std::vector<std::string>& out ) { input_.dump_all( out ); }
-  void all_remaining( std::string& out ) { input_.dump_all( out ); }
+  void all_remaining( std::vector<Buffer>& out ) { input_.dump_all( out ); }
+  void all_remaining( Buffer& out ) { input_.dump_all( out ); }
   std::vector<std::string_view> buffer() const { return input_.buffer(); }
 };
 
 class Serializer
 {
-  std::vector<std::string> output_ {};
+  std::vector<Buffer> output_ {};
   std::string buffer_ {};
 
 public:
-  Serializer() = default;
+  // Room for the headers of a whole packet (Ethernet + IPv4 + TCP, without options) in one allocation
+  static constexpr size_t HEADROOM = 64;
+
+  // Buffers shorter than this (e.g. an encapsulated header) are appended to the current one instead of
+  // being output separately, so a packet's headers come out contiguous, ahead of its payload.
+  static constexpr size_t COALESCE_LIMIT = HEADROOM;
+
+  Serializer() { buffer_.reserve( HEADROOM ); }
   explicit Serializer( std::string&& buffer ) : buffer_( std::move( buffer ) ) {}
 
   template<std::unsigned_integral T>
   void integer( const T val )
   {
-    constexpr uint64_t len = sizeof( T );
+    const size_t offset = buffer_.size();
+    buffer_.resize( offset + sizeof( T ) );
+    store_big_endian( buffer_.data() + offset, val );
+  }
 
-    for ( uint64_t i = 0; i < len; ++i ) {
-      const uint8_t byte_val = val >> ( ( len - i - 1 ) * 8 );
-      buffer_.push_back( byte_val );
-    }
+  // Append `len` zero bytes to the output, and return where they are, to be filled in place (e.g. with a
+  // fixed-length header). The pointer is valid until the next call on this Serializer.
+  char* append( const size_t len )
+  {
+    const size_t offset = buffer_.size();
+    buffer_.resize( offset + len );
+    return buffer_.data() + offset;
   }
 
-  void buffer( std::string buf )
+  void buffer( Buffer buf )
   {
-    flush();
-    if ( not buf.empty() ) {
-      output_.push_back( std::move( buf ) );
+    if ( buf.size() < COALESCE_LIMIT ) {
+      buffer_.append( buf.view() );
+      Buffer::record_copy( buf.size() );
+      return;
     }
+    flush();
+    output_.push_back( std::move( buf ) );
   }
 
-  void buffer( const std::vector<std::string>& bufs )
+  void buffer( const std::vector<Buffer>& bufs )
   {
     for ( const auto& b : bufs ) {
       buffer( b );
     }
   }
 
+  void buffer( std::vector<Buffer>&& bufs )
+  {
+    for ( auto& b : bufs ) {
+      buffer( std::move( b ) );
+    }
+  }
+
   void flush()
   {
     if ( not buffer_.empty() ) {
@@ -212,27 +305,60 @@ public:
     }
   }
 
-  const std::vector<std::string>& output()
+  const std::vector<Buffer>& output()
   {
     flush();
     return output_;
   }
+
+  // Move the output out (instead of copying it, as output() would)
+  std::vector<Buffer> finish()
+  {
+    flush();
+    return std::move( output_ );
+  }
 };
 
 // Helper to serialize any object (without constructing a Serializer of the caller's own)
 template<class T>
-std::vector<std::string> serialize( const T& obj )
+std::vector<Buffer> serialize( const T& obj )
 {
   Serializer s;
   obj.serialize( s );
-  return s.output();
+  return s.finish();
+}
+
+// Same, but a temporary object can hand its payload buffers to the output instead of having them copied
+template<class T>
+requires( not std::is_lvalue_reference_v<T> ) std::vector<Buffer> serialize( T&& obj )
+{
+  Serializer s;
+  std::move( obj ).serialize( s );
+  return s.finish();
 }
 
 // Helper to parse any object (without constructing a Parser of the caller's own). Returns true if successful.
 template<class T, typename... Targs>
-bool parse( T& obj, const std::vector<std::string>& buffers, Targs&&... Fargs )
+bool parse( T& obj, const std::vector<Buffer>& buffers, Targs&&... Fargs )
 {
   Parser p { buffers };
   obj.parse( p, std::forward<Targs>( Fargs )... );
   return not p.has_error();
 }
+
+// Same, but the Parser takes ownership of the buffers
+template<class T, typename... Targs>
+bool parse( T& obj, std::vector<Buffer>&& buffers, Targs&&... Fargs )
+{
+  Parser p { std::move( buffers ) };
+  obj.parse( p, std::forward<Targs>( Fargs )... );
+  return not p.has_error();
+}
+
+template<class T, typename... Targs>
+bool parse( T& obj, std::vector<std::string>&& buffers, Targs&&... Fargs )
+{
+  Parser p { std::move( buffers ) };
+  obj.parse( p, std::forward<Targs>( Fargs )... );
+  return not p.has_error();
+}
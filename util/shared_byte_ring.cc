@@ -0,0 +1,158 @@
+#include "shared_byte_ring.hh"
+#include "exception.hh"
+
+#include <algorithm>
+#include <bit>
+#include <poll.h>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+void wait_for_readable( FileDescriptor& fd )
+{
+  pollfd pfd { fd.fd_num(), POLLIN, 0 };
+  CheckSystemCall( "poll", ::poll( &pfd, 1, -1 ) );
+}
+} // namespace
+
+SharedByteRing::SharedByteRing( const size_t capacity )
+  : buffer_( bit_ceil( max<size_t>( capacity, 1 ) ) ), mask_( buffer_.size() - 1 )
+{
+  // the ring starts out empty, so there is room
+  space_notify_.notify();
+}
+
+span<char> SharedByteRing::writable_region()
+{
+  const uint64_t tail = tail_.load( memory_order_relaxed );
+  const uint64_t free = capacity() - ( tail - head_.load( memory_order_acquire ) );
+  const size_t start = tail & mask_;
+  return { buffer_.data() + start, min( free, capacity() - start ) };
+}
+
+void SharedByteRing::commit( const size_t len )
+{
+  const uint64_t old_tail = tail_.load( memory_order_relaxed );
+  const uint64_t new_tail = old_tail + len;
+  if ( len > 0 ) {
+    tail_.store( new_tail );
+    // If the consumer had caught up, it may be asleep waiting for these bytes
+    if ( head_.load() == old_tail ) {
+      data_notify_.notify();
+    }
+  }
+
+  // A full ring must not look writable. If the consumer makes room after the drain, it notifies again.
+  if ( new_tail - head_.load() == capacity() ) {
+    space_notify_.drain();
+    if ( new_tail - head_.load() < capacity() or has_error() ) {
+      space_notify_.notify();
+    }
+  }
+}
+
+size_t SharedByteRing::push( string_view data )
+{
+  size_t total = 0;
+  // at most two copies: up to the end of the buffer, then from its start
+  for ( int i = 0; i < 2 and not data.empty(); ++i ) {
+    const auto region = writable_region();
+    const size_t len = min( region.size(), data.size() );
+    copy_n( data.data(), len, region.data() );
+    commit( len );
+    data.remove_prefix( len );
+    total += len;
+  }
+  return total;
+}
+
+void SharedByteRing::close()
+{
+  closed_.store( true );
+  data_notify_.notify();
+}
+
+size_t SharedByteRing::available_capacity() const
+{
+  return capacity() - bytes_buffered();
+}
+
+bool SharedByteRing::is_closed() const
+{
+  return closed_.load();
+}
+
+void SharedByteRing::wait_until_writable()
+{
+  while ( available_capacity() == 0 and not has_error() ) {
+    space_notify_.drain();
+    if ( available_capacity() > 0 or has_error() ) {
+      space_notify_.notify();
+      return;
+    }
+    wait_for_readable( space_notify_ );
+  }
+}
+
+string_view SharedByteRing::peek() const
+{
+  const uint64_t head = head_.load( memory_order_relaxed );
+  const uint64_t used = tail_.load( memory_order_acquire ) - head;
+  const size_t start = head & mask_;
+  return { buffer_.data() + start, min( used, capacity() - start ) };
+}
+
+void SharedByteRing::pop( const size_t len )
+{
+  const uint64_t old_head = head_.load( memory_order_relaxed );
+  const uint64_t new_head = old_head + len;
+  if ( len > bytes_buffered() ) {
+    throw runtime_error( "SharedByteRing: pop of more bytes than buffered" );
+  }
+
+  if ( len > 0 ) {
+    head_.store( new_head );
+    // If the ring was full, the producer may be asleep waiting for room
+    if ( tail_.load() - old_head >= capacity() ) {
+      space_notify_.notify();
+    }
+  }
+
+  // An empty ring must not look readable. If the producer adds bytes after the drain, it notifies again.
+  if ( tail_.load() == new_head and not is_closed() ) {
+    data_notify_.drain();
+    if ( tail_.load() != new_head or is_closed() or has_error() ) {
+      data_notify_.notify();
+    }
+  }
+}
+
+size_t SharedByteRing::bytes_buffered() const
+{
+  return tail_.load() - head_.load();
+}
+
+bool SharedByteRing::is_finished() const
+{
+  return is_closed() and bytes_buffered() == 0;
+}
+
+void SharedByteRing::wait_until_readable()
+{
+  while ( bytes_buffered() == 0 and not is_closed() and not has_error() ) {
+    data_notify_.drain();
+    if ( bytes_buffered() > 0 or is_closed() or has_error() ) {
+      data_notify_.notify();
+      return;
+    }
+    wait_for_readable( data_notify_ );
+  }
+}
+
+void SharedByteRing::set_error()
+{
+  error_.store( true );
+  data_notify_.notify();
+  space_notify_.notify();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "eventfd.hh"
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+//! \brief A single-producer, single-consumer byte ring shared between two threads
+//! \details The producer and consumer each own one position in the ring and exchange data with no locks
+//! and no system calls on the fast path. Each side also gets an EventFD it can poll (or hand to an
+//! EventLoop) to sleep until the other side makes progress:
+//!
+//! - data_fd() is readable whenever bytes are buffered or the ring is closed
+//! - space_fd() is readable whenever the ring has room (or has an error)
+//!
+//! Either fd may also be readable spuriously. The fds are only touched when the ring goes from
+//! empty to non-empty or from full to not full, so a steady stream of data makes few system calls.
+//!
+//! The interface follows the ByteStream Writer (for the producer) and Reader (for the consumer).
+class SharedByteRing
+{
+public:
+  //! Construct a ring that holds at least `capacity` bytes (rounded up to a power of two)
+  explicit SharedByteRing( size_t capacity );
+
+  //! \name
+  //! Producer side
+
+  //!@{
+  std::span<char> writable_region(); //!< The contiguous free space the producer may fill next
+  void commit( size_t len );         //!< Publish `len` bytes written into writable_region()
+  size_t push( std::string_view data ); //!< Copy as much of `data` as fits; returns the number of bytes copied
+  void close();                         //!< Signal that nothing more will be pushed
+  size_t available_capacity() const;    //!< How many bytes can be pushed right now?
+  bool is_closed() const;               //!< Has the ring been closed?
+  void wait_until_writable();           //!< Block until the ring has room (or has an error)
+  FileDescriptor& space_fd() { return space_notify_; }
+  //!@}
+
+  //! \name
+  //! Consumer side
+
+  //!@{
+  std::string_view peek() const; //!< The contiguous buffered bytes the consumer may read next
+  void pop( size_t len );        //!< Remove `len` bytes from the front of the ring
+  size_t bytes_buffered() const; //!< How many bytes are buffered?
+  bool is_finished() const;      //!< Has the ring been closed and fully popped?
+  void wait_until_readable();    //!< Block until bytes are buffered (or the ring is closed or has an error)
+  FileDescriptor& data_fd() { return data_notify_; }
+  //!@}
+
+  void set_error(); //!< Signal an error to both sides
+  bool has_error() const { return error_.load(); }
+
+private:
+  std::vector<char> buffer_;
+  size_t mask_;
+
+  // Each position only ever increases; it is reduced modulo the capacity to index the buffer.
+  // They live on separate cache lines so the two threads do not contend for them.
+  alignas( 64 ) std::atomic<uint64_t> head_ { 0 }; //!< Written by the consumer
+  alignas( 64 ) std::atomic<uint64_t> tail_ { 0 }; //!< Written by the producer
+  alignas( 64 ) std::atomic_bool closed_ { false };
+  std::atomic_bool error_ { false };
+
+  EventFD data_notify_ {};
+  EventFD space_notify_ {};
+
+  size_t capacity() const { return buffer_.size(); }
+};
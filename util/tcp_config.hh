@@ -3,6 +3,7 @@
 #include "address.hh"
 #include "wrapping_integers.hh"
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
@@ -20,6 +21,35 @@ public:
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+
+  //! Initial retransmission timeout with sub-millisecond resolution; overrides rt_timeout when set
+  std::optional<std::chrono::microseconds> rt_timeout_us {};
+
+  //! The initial retransmission timeout actually in effect
+  std::chrono::microseconds initial_RTO() const
+  {
+    return rt_timeout_us.value_or( std::chrono::milliseconds { rt_timeout } );
+  }
+};
+
+//! Impairments for one direction of a NetemFdAdapter. Rates and probabilities are out of 65536, as for loss_rate.
+struct NetemConfig
+{
+  std::chrono::microseconds delay {};  //!< Propagation delay
+  std::chrono::microseconds jitter {}; //!< Each datagram's delay varies uniformly by up to this much either way
+  uint64_t rate = 0;                   //!< Bottleneck rate in bytes per second (0 for unlimited)
+  size_t queue_limit = 0;              //!< Datagrams the bottleneck holds before dropping (0 for unlimited)
+  uint16_t reorder_rate = 0;           //!< Probability that a datagram skips the delay, overtaking others
+
+  //! \name
+  //! Gilbert-Elliott loss: the channel flips between a "good" and a "bad" state, each with its own loss rate
+
+  //!@{
+  uint16_t loss_good = 0;   //!< Loss rate in the good state
+  uint16_t loss_bad = 0;    //!< Loss rate in the bad state
+  uint16_t good_to_bad = 0; //!< Probability of moving to the bad state, per datagram
+  uint16_t bad_to_good = 0; //!< Probability of moving to the good state, per datagram
+  //!@}
 };
 
 //! Config for classes derived from FdAdapter
@@ -31,4 +61,7 @@ public:
 
   uint16_t loss_rate_dn = 0; //!< Downlink loss rate (for LossyFdAdapter)
   uint16_t loss_rate_up = 0; //!< Uplink loss rate (for LossyFdAdapter)
+
+  NetemConfig netem_dn {}; //!< Downlink impairments (for NetemFdAdapter)
+  NetemConfig netem_up {}; //!< Uplink impairments (for NetemFdAdapter)
 };
@@ -1,14 +1,18 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "eventfd.hh"
 #include "eventloop.hh"
 #include "file_descriptor.hh"
+#include "loopback_adapter.hh"
+#include "shared_byte_ring.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
 #include "tcp_peer.hh"
 #include "tuntap_adapter.hh"
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <optional>
 #include <thread>
@@ -55,6 +59,20 @@ public:
   void set_reuseaddr() = delete;
   //!@}
 
+  //! \name
+  //! Optional shared-memory data path, in place of read() and write() on this socket. Call enable_shared_rings()
+  //! before connect() or listen_and_accept(); the owner then pushes outbound bytes into outbound_ring() and pops
+  //! inbound bytes from inbound_ring(), with no system calls on the fast path. This is not zero-copy: the TCPPeer
+  //! thread copies each byte once between a ring and its ByteStream (which keeps outbound bytes until they are
+  //! acknowledged). An owner that fills writable_region() and reads peek() in place makes no other copy, where
+  //! the socketpair costs two per byte (into the kernel and out again).
+
+  //!@{
+  void enable_shared_rings( size_t capacity = TCPConfig::DEFAULT_CAPACITY );
+  SharedByteRing& outbound_ring(); //!< The owner writes here (and closes it to end the outbound stream)
+  SharedByteRing& inbound_ring();  //!< The owner reads here
+  //!@}
+
   // Return peer address from underlying datagram adapter
   const Address& peer_address() const { return _datagram_adapter.config().destination; }
 
@@ -66,6 +84,10 @@ private:
   //! Stream socket for reads and writes between owner and TCP thread
   LocalStreamSocket _thread_data;
 
+  //! Rings shared with the owner, if enable_shared_rings() was called (otherwise _thread_data carries the data)
+  std::optional<SharedByteRing> _shared_outbound {};
+  std::optional<SharedByteRing> _shared_inbound {};
+
   //! Set up the TCPPeer and the event loop
   void _initialize_TCP( const TCPConfig& config );
 
@@ -75,9 +97,21 @@ private:
   //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
   EventLoop _eventloop {};
 
+  //! Set up the event loop rules that exchange data with the owner through the shared rings
+  void _add_shared_ring_rules();
+
   //! Process events while specified condition is true
   void _tcp_loop( const std::function<bool()>& condition );
 
+  //! Advance the TCPPeer's and adapter's clocks to the current time
+  void _tick();
+
+  //! When the TCPPeer and adapter were last ticked
+  std::chrono::microseconds _last_tick_time {};
+
+  //! How long the event loop may sleep before a TCPPeer or adapter timer needs servicing
+  std::optional<std::chrono::microseconds> _next_timeout( std::chrono::microseconds elapsed ) const;
+
   //! Main loop of TCPPeer thread
   void _tcp_main();
 
@@ -89,6 +123,8 @@ private:
 
   std::atomic_bool _abort { false }; //!< Flag used by the owner to force the TCPPeer thread to shut down
 
+  EventFD _abort_notify {}; //!< Wakes the TCPPeer thread from poll after _abort is set
+
   bool _inbound_shutdown { false }; //!< Has TCPMinnowSocket shut down the incoming data to the owner?
 
   bool _outbound_shutdown { false }; //!< Has the owner shut down the outbound data to the TCP connection?
@@ -98,6 +134,8 @@ private:
 
 using TCPOverIPv4MinnowSocket = TCPMinnowSocket<TCPOverIPv4OverTunFdAdapter>;
 using LossyTCPOverIPv4MinnowSocket = TCPMinnowSocket<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+using NetemTCPOverIPv4MinnowSocket = TCPMinnowSocket<NetemFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+using LoopbackMinnowSocket = TCPMinnowSocket<LoopbackAdapter>;
 
 //! \class TCPMinnowSocket
 //! This class involves the simultaneous operation of two threads.
@@ -15,22 +15,50 @@
 #include <unistd.h>
 #include <utility>
 
-static constexpr size_t TCP_TICK_MS = 10;
+inline std::chrono::microseconds timestamp_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() );
+}
 
-inline uint64_t timestamp_ms()
+//! \param[in] elapsed is the time that has passed since the TCPPeer and adapter were last ticked
+//! \returns the poll timeout that wakes the loop exactly when the next timer is due, or empty if none is running
+template<TCPDatagramAdapter AdaptT>
+std::optional<std::chrono::microseconds> TCPMinnowSocket<AdaptT>::_next_timeout(
+  const std::chrono::microseconds elapsed ) const
 {
-  static_assert( std::is_same<std::chrono::steady_clock::duration, std::chrono::nanoseconds>::value );
+  auto timeout = _tcp.has_value() ? _tcp->next_timeout() : std::nullopt;
+  if ( const auto adapter_timeout = _datagram_adapter.next_timeout() ) {
+    timeout = std::min( timeout.value_or( adapter_timeout.value() ), adapter_timeout.value() );
+  }
+
+  if ( not timeout.has_value() ) {
+    return {};
+  }
 
-  return std::chrono::steady_clock::now().time_since_epoch().count() / 1000000;
+  return std::max( timeout.value() - elapsed, std::chrono::microseconds::zero() );
+}
+
+//! \details The loop sleeps until the next timer is due, so each event handler calls this first:
+//! otherwise segments sent or acknowledged after an idle period would be timestamped in the past.
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_tick()
+{
+  if ( _tcp.has_value() and _tcp.value().active() ) {
+    const auto next_time = timestamp_us();
+    _tcp.value().tick( next_time - _last_tick_time, [&]( auto x ) { _datagram_adapter.write( x ); } );
+    _datagram_adapter.tick( next_time - _last_tick_time );
+    _last_tick_time = next_time;
+  }
 }
 
 //! \param[in] condition is a function returning true if loop should continue
 template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition )
 {
-  auto base_time = timestamp_ms();
+  _last_tick_time = timestamp_us();
   while ( condition() ) {
-    auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
+    auto ret = _eventloop.wait_next_event( _next_timeout( timestamp_us() - _last_tick_time ) );
     if ( ret == EventLoop::Result::Exit or _abort ) {
       break;
     }
@@ -39,12 +67,7 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition
       throw std::runtime_error( "_tcp_loop entered before TCPPeer initialized" );
     }
 
-    if ( _tcp.value().active() ) {
-      const auto next_time = timestamp_ms();
-      _tcp.value().tick( next_time - base_time, [&]( auto x ) { _datagram_adapter.write( x ); } );
-      _datagram_adapter.tick( next_time - base_time );
-      base_time = next_time;
-    }
+    _tick();
   }
 }
 
@@ -80,18 +103,28 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
   //    (needs to be read from the inbound_stream and written
   //    to the local stream socket back to the application)
 
+  // There are no periodic wakeups: the loop sleeps until the next timer is due, so the owner
+  // needs its own event to interrupt the TCPPeer thread when forcing a shutdown.
+  _eventloop.add_rule(
+    "abort requested by owner",
+    _abort_notify,
+    Direction::In,
+    [&] { _abort_notify.drain(); },
+    [&] { return _tcp->active(); } );
+
   // rule 1: read from filtered packet stream and dump into TCPConnection
   _eventloop.add_rule(
     "receive TCP segment from the network",
     _datagram_adapter.fd(),
     Direction::In,
     [&] {
+      _tick();
       if ( auto seg = _datagram_adapter.read() ) {
         _tcp->receive( std::move( seg.value() ), [&]( auto x ) { _datagram_adapter.write( x ); } );
       }
 
       // debugging output:
-      if ( _thread_data.eof() and _tcp.value().sender().sequence_numbers_in_flight() == 0 and not _fully_acked ) {
+      if ( _outbound_shutdown and _tcp.value().sender().sequence_numbers_in_flight() == 0 and not _fully_acked ) {
         std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
                   << " has been fully acknowledged.\n";
         _fully_acked = true;
@@ -99,12 +132,32 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     },
     [&] { return _tcp->active(); } );
 
+  // rule 1a: an adapter that delays datagrams (e.g. NetemFdAdapter) may have one due without its fd being readable
+  if constexpr ( requires { _datagram_adapter.read_delayed(); } ) {
+    _eventloop.add_rule(
+      "receive delayed TCP segment",
+      [&] {
+        _tick();
+        while ( auto seg = _datagram_adapter.read_delayed() ) {
+          _tcp->receive( std::move( seg.value() ), [&]( auto x ) { _datagram_adapter.write( x ); } );
+        }
+      },
+      [&] { return _tcp->active() and _datagram_adapter.has_delayed_read(); } );
+  }
+
+  // rules 2 and 3 use the shared rings instead of the pipe if the owner asked for them
+  if ( _shared_outbound.has_value() ) {
+    _add_shared_ring_rules();
+    return;
+  }
+
   // rule 2: read from pipe into outbound buffer
   _eventloop.add_rule(
     "push bytes to TCPPeer",
     _thread_data,
     Direction::In,
     [&] {
+      _tick();
       std::string data;
       data.resize( _tcp->outbound_writer().available_capacity() );
       _thread_data.read( data );
@@ -173,6 +226,79 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     } );
 }
 
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_add_shared_ring_rules()
+{
+  // rule 2: read from outbound ring into outbound buffer
+  _eventloop.add_rule(
+    "push bytes from shared ring to TCPPeer",
+    _shared_outbound->data_fd(),
+    Direction::In,
+    [&] {
+      _tick();
+      SharedByteRing& ring = _shared_outbound.value();
+      Writer& outbound = _tcp->outbound_writer();
+      // Take bytes until the ring is empty (which drains its fd) or the sender can take no more. They're copied out
+      // of the ring, since the sender keeps them until they're acknowledged but the owner needs the space back.
+      std::string_view data;
+      do {
+        data = ring.peek().substr( 0, outbound.available_capacity() );
+        outbound.push( std::string { data } );
+        ring.pop( data.size() );
+        _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+      } while ( not data.empty() );
+
+      if ( ring.has_error() ) {
+        std::cerr << "DEBUG: minnow outbound stream had error.\n";
+        outbound.set_error();
+        _outbound_shutdown = true;
+      } else if ( ring.is_finished() ) {
+        outbound.close();
+        _outbound_shutdown = true;
+        std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
+                  << " finished.\n";
+        _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+      }
+    },
+    [&] {
+      return ( _tcp->active() ) and ( not _outbound_shutdown )
+             and ( _tcp->outbound_writer().available_capacity() > 0 );
+    } );
+
+  // rule 3: read from inbound buffer into inbound ring
+  _eventloop.add_rule(
+    "write bytes from inbound stream to shared ring",
+    _shared_inbound->space_fd(),
+    Direction::In,
+    [&] {
+      SharedByteRing& ring = _shared_inbound.value();
+      Reader& inbound = _tcp->inbound_reader();
+      // Give bytes until the inbound stream is empty or the ring is full (which drains its fd)
+      size_t bytes_written = 0;
+      do {
+        bytes_written = ring.push( inbound.peek() );
+        inbound.pop( bytes_written );
+      } while ( bytes_written > 0 and inbound.bytes_buffered() );
+
+      if ( inbound.has_error() ) {
+        ring.set_error();
+        _inbound_shutdown = true;
+        std::cerr << "DEBUG: minnow inbound stream from " << _datagram_adapter.config().destination.to_string()
+                  << " finished uncleanly.\n";
+      } else if ( inbound.is_finished() ) {
+        ring.close();
+        _inbound_shutdown = true;
+        std::cerr << "DEBUG: minnow inbound stream from " << _datagram_adapter.config().destination.to_string()
+                  << " finished cleanly.\n";
+      }
+    },
+    [&] {
+      return _tcp->inbound_reader().bytes_buffered()
+             or ( ( _tcp->inbound_reader().is_finished() or _tcp->inbound_reader().has_error() )
+                  and not _inbound_shutdown );
+    } );
+}
+
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
 //! \param[in] type is the type of AF_UNIX sockets to create (e.g., SOCK_SEQPACKET)
 //! \returns a std::pair of connected sockets
@@ -199,6 +325,7 @@ TCPMinnowSocket<AdaptT>::~TCPMinnowSocket()
       std::cerr << "Warning: unclean shutdown of TCPMinnowSocket\n";
       // force the other side to exit
       _abort.store( true );
+      _abort_notify.notify();
       _tcp_thread.join();
     }
   } catch ( const std::exception& e ) {
@@ -206,10 +333,43 @@ TCPMinnowSocket<AdaptT>::~TCPMinnowSocket()
   }
 }
 
+//! \param[in] capacity is the number of bytes each ring holds (rounded up to a power of two)
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::enable_shared_rings( const size_t capacity )
+{
+  if ( _tcp ) {
+    throw std::runtime_error( "enable_shared_rings() with TCPConnection already initialized" );
+  }
+
+  _shared_outbound.emplace( capacity );
+  _shared_inbound.emplace( capacity );
+}
+
+template<TCPDatagramAdapter AdaptT>
+SharedByteRing& TCPMinnowSocket<AdaptT>::outbound_ring()
+{
+  if ( not _shared_outbound.has_value() ) {
+    throw std::runtime_error( "outbound_ring() without enable_shared_rings()" );
+  }
+  return _shared_outbound.value();
+}
+
+template<TCPDatagramAdapter AdaptT>
+SharedByteRing& TCPMinnowSocket<AdaptT>::inbound_ring()
+{
+  if ( not _shared_inbound.has_value() ) {
+    throw std::runtime_error( "inbound_ring() without enable_shared_rings()" );
+  }
+  return _shared_inbound.value();
+}
+
 template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::wait_until_closed()
 {
   shutdown( SHUT_RDWR );
+  if ( _shared_outbound.has_value() and not _shared_outbound->is_closed() ) {
+    _shared_outbound->close();
+  }
   if ( _tcp_thread.joinable() ) {
     std::cerr << "DEBUG: minnow waiting for clean shutdown... ";
     _tcp_thread.join();
@@ -282,6 +442,12 @@ void TCPMinnowSocket<AdaptT>::_tcp_main()
     }
     _tcp_loop( [] { return true; } );
     shutdown( SHUT_RDWR );
+    if ( _shared_inbound.has_value() and not _inbound_shutdown ) {
+      _shared_inbound->set_error();
+    }
+    if ( _shared_outbound.has_value() and not _shared_outbound->is_finished() ) {
+      _shared_outbound->set_error();
+    }
     if ( not _tcp.value().active() ) {
       std::cerr << "DEBUG: minnow TCP connection finished "
                 << ( _tcp->inbound_reader().has_error() ? "uncleanly.\n" : "cleanly.\n" );
@@ -1,5 +1,6 @@
 #include "tcp_over_ip.hh"
 
+#include "checksum.hh"
 #include "ipv4_datagram.hh"
 #include "ipv4_header.hh"
 #include "parser.hh"
@@ -18,21 +19,26 @@ using namespace std;
 //! current connection. When a TCP connection has been established, this means
 //! checking that the source and destination ports in the TCP header are correct.
 //!
+//! Under ChecksumPolicy::Defer, the segment's checksum is only verified once it has passed these checks, so
+//! segments for other connections are dropped without summing their payloads.
+//!
 //! If the TCP connection is listening (i.e., TCPOverIPv4OverTunFdAdapter::_listen is `true`)
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and records the source and destination addresses and port numbers
 //! from the TCP header; it uses this information to filter future reads.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
-optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagram& ip_dgram )
+optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( InternetDatagram&& ip_dgram )
 {
+  const HeaderTemplate& expected = header_template();
+
   // is the IPv4 datagram for us?
   // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
-  if ( not listening() and ( ip_dgram.header.dst != config().source.ipv4_numeric() ) ) {
+  if ( not listening() and ( ip_dgram.header.dst != expected.ip.src ) ) {
     return {};
   }
 
   // is the IPv4 datagram from our peer?
-  if ( not listening() and ( ip_dgram.header.src != config().destination.ipv4_numeric() ) ) {
+  if ( not listening() and ( ip_dgram.header.src != expected.ip.dst ) ) {
     return {};
   }
 
@@ -41,21 +47,31 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
     return {};
   }
 
-  // is the payload a valid TCP segment?
+  // is the payload a valid TCP segment? (perhaps leaving its checksum until it turns out to be for us)
   TCPSegment tcp_seg;
-  if ( not parse( tcp_seg, ip_dgram.payload, ip_dgram.header.pseudo_checksum() ) ) {
+  const uint32_t pseudo_checksum = ip_dgram.header.pseudo_checksum();
+  if ( not parse( tcp_seg, std::move( ip_dgram.payload ), pseudo_checksum, checksum_policy() ) ) {
     return {};
   }
 
   // is the TCP segment for us?
-  if ( tcp_seg.udinfo.dst_port != config().source.port() ) {
+  if ( tcp_seg.udinfo.dst_port != expected.src_port ) {
+    return {};
+  }
+
+  // is the TCP segment from our peer?
+  if ( not listening() and tcp_seg.udinfo.src_port != expected.dst_port ) {
+    return {};
+  }
+
+  if ( checksum_policy() == ChecksumPolicy::Defer and not tcp_seg.verify_checksum( pseudo_checksum ) ) {
     return {};
   }
 
   // should we target this source addr/port (and use its destination addr as our source) in reply?
   if ( listening() ) {
     if ( tcp_seg.message.sender.SYN and not tcp_seg.message.sender.RST ) {
-      config_mutable().source = Address { inet_ntoa( { htobe32( ip_dgram.header.dst ) } ), config().source.port() };
+      config_mutable().source = Address { inet_ntoa( { htobe32( ip_dgram.header.dst ) } ), expected.src_port };
       config_mutable().destination
         = Address { inet_ntoa( { htobe32( ip_dgram.header.src ) } ), tcp_seg.udinfo.src_port };
       set_listening( false );
@@ -64,33 +80,54 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
     }
   }
 
-  // is the TCP segment from our peer?
-  if ( tcp_seg.udinfo.src_port != config().destination.port() ) {
-    return {};
-  }
-
-  return tcp_seg.message;
+  return std::move( tcp_seg.message );
 }
 
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg )
 {
+  const HeaderTemplate& prebuilt = header_template();
+
   TCPSegment seg { .message = msg };
   // set the port numbers in the TCP segment
-  seg.udinfo.src_port = config().source.port();
-  seg.udinfo.dst_port = config().destination.port();
+  seg.udinfo.src_port = prebuilt.src_port;
+  seg.udinfo.dst_port = prebuilt.dst_port;
 
-  // create an Internet Datagram and set its addresses and length
+  // create an Internet Datagram with the prebuilt addresses, and patch in its length (and so its checksum)
   InternetDatagram ip_dgram;
-  ip_dgram.header.src = config().source.ipv4_numeric();
-  ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + seg.message.sender.payload.size();
+  ip_dgram.header = prebuilt.ip;
+  const auto tcp_len = static_cast<uint16_t>( TCPSegment::HEADER_LENGTH + seg.message.sender.payload.size() );
+  ip_dgram.header.len += tcp_len;
+  ip_dgram.header.cksum = InternetChecksum::adjust( prebuilt.ip.cksum, prebuilt.ip.len, ip_dgram.header.len );
 
-  // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
-  ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
+  // set payload, calculating TCP checksum (unless the receiver won't check it)
+  if ( checksum_policy() != ChecksumPolicy::Trust ) {
+    seg.compute_checksum( prebuilt.pseudo_checksum + tcp_len );
+  }
+  ip_dgram.payload = serialize( std::move( seg ) );
 
   return ip_dgram;
 }
+
+const TCPOverIPv4Adapter::HeaderTemplate& TCPOverIPv4Adapter::header_template()
+{
+  if ( header_template_.has_value() and header_template_->source == config().source
+       and header_template_->destination == config().destination ) {
+    return header_template_.value();
+  }
+
+  IPv4Header ip;
+  ip.src = config().source.ipv4_numeric();
+  ip.dst = config().destination.ipv4_numeric();
+  ip.len = ip.hlen * 4; // with an empty payload
+  ip.compute_checksum();
+
+  header_template_.emplace( HeaderTemplate { .source = config().source,
+                                             .destination = config().destination,
+                                             .src_port = config().source.port(),
+                                             .dst_port = config().destination.port(),
+                                             .ip = ip,
+                                             .pseudo_checksum = ip.pseudo_checksum() } );
+  return header_template_.value();
+}
@@ -1,16 +1,44 @@
 #pragma once
 
+#include "address.hh"
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
+#include "ipv4_header.hh"
 #include "tcp_segment.hh"
 
+#include <cstdint>
 #include <optional>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase
 {
 public:
-  std::optional<TCPMessage> unwrap_tcp_in_ip( const InternetDatagram& ip_dgram );
+  //! Takes ownership of the datagram's payload buffers, so the TCP payload is moved rather than copied out of them
+  std::optional<TCPMessage> unwrap_tcp_in_ip( InternetDatagram&& ip_dgram );
+
+  std::optional<TCPMessage> unwrap_tcp_in_ip( const InternetDatagram& ip_dgram )
+  {
+    return unwrap_tcp_in_ip( InternetDatagram { ip_dgram } );
+  }
 
   InternetDatagram wrap_tcp_in_ip( const TCPMessage& msg );
+
+private:
+  //! \brief The parts of the IPv4 and TCP headers that are the same for every segment of a connection
+  //! \details Built from the configured addresses when they change, which saves converting them (and summing
+  //! them into the checksums) for every segment.
+  struct HeaderTemplate
+  {
+    Address source;           //!< Configured source address the template was built from
+    Address destination;      //!< Configured destination address the template was built from
+    uint16_t src_port;        //!< Source port
+    uint16_t dst_port;        //!< Destination port
+    IPv4Header ip;            //!< IPv4 header (and its checksum) for an empty payload
+    uint32_t pseudo_checksum; //!< TCP pseudo-header's contribution to the checksum, for an empty segment
+  };
+
+  std::optional<HeaderTemplate> header_template_ {};
+
+  //! The header template for the current configuration (rebuilt if the configured addresses have changed)
+  const HeaderTemplate& header_template();
 };
@@ -7,6 +7,8 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <optional>
 
@@ -28,23 +30,38 @@ public:
 
   /* Passthrough methods */
   void push( const TransmitFunction& transmit ) { sender_.push( make_send( transmit ) ); }
-  void tick( uint64_t t, const TransmitFunction& transmit )
+  void tick( std::chrono::microseconds t, const TransmitFunction& transmit )
   {
     cumulative_time_ += t;
     sender_.tick( t, make_send( transmit ) );
   }
+  void tick( uint64_t ms, const TransmitFunction& transmit ) { tick( std::chrono::milliseconds { ms }, transmit ); }
   bool has_ackno() const { return receiver_.send().ackno.has_value(); }
 
   /* Is the peer still active? */
   bool active() const
   {
-    const bool any_errors = receiver_.reader().has_error() or sender_.writer().has_error();
-    const bool sender_active = sender_.sequence_numbers_in_flight() or not sender_.reader().is_finished();
-    const bool receiver_active = not receiver_.writer().is_closed();
-    const bool lingering
-      = linger_after_streams_finish_ and ( cumulative_time_ < time_of_last_receipt_ + 10UL * cfg_.rt_timeout );
+    const bool lingering = linger_after_streams_finish_ and ( cumulative_time_ < linger_deadline() );
 
-    return ( not any_errors ) and ( sender_active or receiver_active or lingering );
+    return ( not any_errors() ) and ( streams_active() or lingering );
+  }
+
+  /* How long until tick() next has work to do? (empty if only an incoming event can wake the peer) */
+  std::optional<std::chrono::microseconds> next_timeout() const
+  {
+    if ( not active() ) {
+      return {};
+    }
+
+    auto timeout = sender_.next_timeout();
+
+    // Once both streams are finished, the peer stays active only until its linger period runs out.
+    if ( not streams_active() ) {
+      const auto linger_remaining = linger_deadline() - cumulative_time_;
+      timeout = std::min( timeout.value_or( linger_remaining ), linger_remaining );
+    }
+
+    return timeout;
   }
 
   void receive( TCPMessage msg, const TransmitFunction& transmit )
@@ -75,6 +92,9 @@ public:
     // Give incoming TCPReceiverMessage to sender.
     sender_.receive( msg.receiver );
 
+    // The ackno or window may have opened room for buffered outbound bytes; any segment sent carries the reply.
+    push( transmit );
+
     // Send reply if needed.
     if ( need_send_ ) {
       send( sender_.make_empty_message(), transmit );
@@ -87,7 +107,7 @@ public:
 
 private:
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
+  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.initial_RTO() };
   TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
 
   bool need_send_ {};
@@ -99,7 +119,18 @@ private:
     need_send_ = false;
   }
 
+  bool any_errors() const { return receiver_.reader().has_error() or sender_.writer().has_error(); }
+
+  bool streams_active() const
+  {
+    const bool sender_active = sender_.sequence_numbers_in_flight() or not sender_.reader().is_finished();
+    const bool receiver_active = not receiver_.writer().is_closed();
+    return sender_active or receiver_active;
+  }
+
+  std::chrono::microseconds linger_deadline() const { return time_of_last_receipt_ + 10 * cfg_.initial_RTO(); }
+
   bool linger_after_streams_finish_ { true }; // one peer may need to linger to make sure all closure conditions met
-  uint64_t cumulative_time_ {};
-  uint64_t time_of_last_receipt_ {};
+  std::chrono::microseconds cumulative_time_ {};
+  std::chrono::microseconds time_of_last_receipt_ {};
 };
@@ -1,57 +1,102 @@
 #include "tcp_segment.hh"
 #include "checksum.hh"
+#include "header_codec.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <stdexcept>
+#include <string_view>
 
 static constexpr uint32_t TCPHeaderMinLen = 5; // 32-bit words
 
 using namespace std;
 
-void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
+namespace {
+using SourcePort = HeaderField<0, 16>;
+using DestinationPort = HeaderField<16, 16>;
+using SequenceNumber = HeaderField<32, 32>;
+using AcknowledgmentNumber = HeaderField<64, 32>;
+using DataOffset = HeaderField<96, 4>;
+using ACK = HeaderField<107, 1>;
+using RST = HeaderField<109, 1>;
+using SYN = HeaderField<110, 1>;
+using FIN = HeaderField<111, 1>;
+using Window = HeaderField<112, 16>;
+using Checksum = HeaderField<128, 16>;
+using UrgentPointer = HeaderField<144, 16>;
+using Layout = HeaderLayout<TCPSegment::HEADER_LENGTH,
+                            SourcePort,
+                            DestinationPort,
+                            SequenceNumber,
+                            AcknowledgmentNumber,
+                            DataOffset,
+                            ACK,
+                            RST,
+                            SYN,
+                            FIN,
+                            Window,
+                            Checksum,
+                            UrgentPointer>;
+} // namespace
+
+void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum, const ChecksumPolicy checksum )
 {
   /* verify checksum */
-  InternetChecksum check { datagram_layer_pseudo_checksum };
-  check.add( parser.buffer() );
-  if ( check.value() ) {
-    parser.set_error();
-    return;
+  if ( checksum == ChecksumPolicy::Verify ) {
+    InternetChecksum check { datagram_layer_pseudo_checksum };
+    check.add( parser.buffer() );
+    if ( check.value() ) {
+      parser.set_error();
+      return;
+    }
   }
 
-  uint32_t raw32 {};
-  uint16_t raw16 {};
-  uint8_t octet {};
+  uint8_t data_offset {};
+  InternetChecksum header_check;
+  Layout::read( parser, [&]( const char* raw ) {
+    if ( checksum == ChecksumPolicy::Defer ) {
+      header_check.add( string_view { raw, Layout::LENGTH } );
+    }
 
-  parser.integer( udinfo.src_port );
-  parser.integer( udinfo.dst_port );
+    udinfo.src_port = SourcePort::get( raw );
+    udinfo.dst_port = DestinationPort::get( raw );
+    message.sender.seqno = Wrap32 { SequenceNumber::get( raw ) };
 
-  parser.integer( raw32 );
-  message.sender.seqno = Wrap32 { raw32 };
+    message.receiver.ackno.reset(); // unless the ACK flag is set
+    if ( ACK::get( raw ) ) {
+      message.receiver.ackno = Wrap32 { AcknowledgmentNumber::get( raw ) };
+    }
 
-  parser.integer( raw32 );
-  message.receiver.ackno = Wrap32 { raw32 };
-
-  parser.integer( octet );
-  const uint8_t data_offset = octet >> 4;
-
-  parser.integer( octet ); // flags
-  if ( not( octet & 0b0001'0000 ) ) {
-    message.receiver.ackno.reset(); // no ACK
-  }
+    data_offset = DataOffset::get( raw );
+    message.sender.RST = message.receiver.RST = RST::get( raw );
+    message.sender.SYN = SYN::get( raw );
+    message.sender.FIN = FIN::get( raw );
 
-  message.sender.RST = message.receiver.RST = octet & 0b0000'0100;
-  message.sender.SYN = octet & 0b0000'0010;
-  message.sender.FIN = octet & 0b0000'0001;
-
-  parser.integer( message.receiver.window_size );
-  parser.integer( udinfo.cksum );
-  parser.integer( raw16 ); // urgent pointer
+    message.receiver.window_size = Window::get( raw );
+    udinfo.cksum = Checksum::get( raw );
+  } );
 
   // skip any options or anything extra in the header
   if ( data_offset < TCPHeaderMinLen ) {
     parser.set_error();
+    return;
+  }
+  const size_t options_len = data_offset * 4 - TCPHeaderMinLen * 4;
+  if ( checksum == ChecksumPolicy::Defer ) {
+    // (the rest of the header is about to be discarded, so sum it now, leaving only the payload for later)
+    size_t remaining = options_len;
+    for ( const auto view : parser.buffer() ) {
+      if ( remaining == 0 ) {
+        break;
+      }
+      header_check.add( view.substr( 0, remaining ) );
+      remaining -= min( remaining, view.size() );
+    }
+    deferred_header_sum = static_cast<uint16_t>( ~header_check.value() );
   }
-  parser.remove_prefix( data_offset * 4 - TCPHeaderMinLen * 4 );
+  parser.remove_prefix( options_len );
 
   parser.all_remaining( message.sender.payload );
 }
@@ -62,30 +107,56 @@ public:
   uint32_t raw_value() const { return raw_value_; }
 };
 
-void TCPSegment::serialize( Serializer& serializer ) const
+void TCPSegment::encode_header( char* raw ) const
 {
-  serializer.integer( udinfo.src_port );
-  serializer.integer( udinfo.dst_port );
-  serializer.integer( Wrap32Serializable { message.sender.seqno }.raw_value() );
-  serializer.integer( Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
-  const bool reset = message.sender.RST or message.receiver.RST;
-  const uint8_t flags = ( message.receiver.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
-                        | ( message.sender.SYN ? 0b0000'0010U : 0 ) | ( message.sender.FIN ? 0b0000'0001U : 0 );
-  serializer.integer( flags );
-  serializer.integer( message.receiver.window_size );
-  serializer.integer( udinfo.cksum );
-  serializer.integer( uint16_t { 0 } ); // urgent pointer
+  SourcePort::set( raw, udinfo.src_port );
+  DestinationPort::set( raw, udinfo.dst_port );
+  SequenceNumber::set( raw, Wrap32Serializable { message.sender.seqno }.raw_value() );
+  AcknowledgmentNumber::set( raw,
+                             Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
+  DataOffset::set( raw, TCPHeaderMinLen );
+  ACK::set( raw, message.receiver.ackno.has_value() );
+  RST::set( raw, message.sender.RST or message.receiver.RST );
+  SYN::set( raw, message.sender.SYN );
+  FIN::set( raw, message.sender.FIN );
+  Window::set( raw, message.receiver.window_size );
+  Checksum::set( raw, udinfo.cksum );
+  UrgentPointer::set( raw, 0 );
+}
+
+void TCPSegment::serialize( Serializer& serializer ) const&
+{
+  Layout::write( serializer, [&]( char* raw ) { encode_header( raw ); } );
   serializer.buffer( message.sender.payload );
 }
 
+void TCPSegment::serialize( Serializer& serializer ) &&
+{
+  Layout::write( serializer, [&]( char* raw ) { encode_header( raw ); } );
+  serializer.buffer( std::move( message.sender.payload ) );
+}
+
+bool TCPSegment::verify_checksum( uint32_t datagram_layer_pseudo_checksum ) const
+{
+  if ( not deferred_header_sum.has_value() ) {
+    throw runtime_error( "TCPSegment::verify_checksum() needs a segment parsed under ChecksumPolicy::Defer" );
+  }
+
+  InternetChecksum check { datagram_layer_pseudo_checksum };
+  check.add_partial( deferred_header_sum.value(), HEADER_LENGTH ); // (any options make it longer, but still even)
+  check.add_partial( message.sender.payload.checksum_partial(), message.sender.payload.size() );
+  return check.value() == 0;
+}
+
 void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
 {
+  // sum the header, and add the payload's sum (known already if the payload was copied into its Buffer)
   udinfo.cksum = 0;
-  Serializer s;
-  serialize( s );
+  array<char, HEADER_LENGTH> raw {};
+  encode_header( raw.data() );
 
   InternetChecksum check { datagram_layer_pseudo_checksum };
-  check.add( s.output() );
+  check.add( string_view { raw.data(), raw.size() } );
+  check.add_partial( message.sender.payload.checksum_partial(), message.sender.payload.size() );
   udinfo.cksum = check.value();
 }
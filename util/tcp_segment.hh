@@ -5,19 +5,46 @@
 #include "tcp_sender_message.hh"
 #include "udinfo.hh"
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
 struct TCPMessage
 {
   TCPSenderMessage sender {};
   TCPReceiverMessage receiver {};
 };
 
+// How a receiver treats the checksums of TCP segments (like the checksum offload settings of a NIC)
+enum class ChecksumPolicy : uint8_t
+{
+  Verify, // verify each segment's checksum as it is parsed
+  Defer,  // parse without verifying, and verify_checksum() once the segment turns out to be wanted
+  Trust,  // neither compute nor verify checksums (for in-process adapters, where nothing can corrupt segments)
+};
+
 struct TCPSegment
 {
+  static constexpr size_t HEADER_LENGTH = 20; // TCP header length, not including options
+
   TCPMessage message {};
   UserDatagramInfo udinfo {};
 
-  void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum );
-  void serialize( Serializer& serializer ) const;
+  // Under ChecksumPolicy::Defer, parse() leaves the sum of the header's bytes (with any options) here
+  std::optional<uint16_t> deferred_header_sum {};
+
+  void parse( Parser& parser,
+              uint32_t datagram_layer_pseudo_checksum,
+              ChecksumPolicy checksum = ChecksumPolicy::Verify );
+  void serialize( Serializer& serializer ) const&;
+  void serialize( Serializer& serializer ) &&; // moves the payload out instead of copying it
 
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
+
+  // Does a segment parsed under ChecksumPolicy::Defer have the right checksum? (Its payload is summed now.)
+  bool verify_checksum( uint32_t datagram_layer_pseudo_checksum ) const;
+
+private:
+  // Write the fixed-length part of the header into `HEADER_LENGTH` bytes (zeroed beforehand)
+  void encode_header( char* raw ) const;
 };
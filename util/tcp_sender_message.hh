@@ -1,9 +1,8 @@
 #pragma once
 
+#include "buffer.hh"
 #include "wrapping_integers.hh"
 
-#include <string>
-
 /*
  * The TCPSenderMessage structure contains the information sent from a TCP sender to its receiver.
  *
@@ -27,7 +26,7 @@ struct TCPSenderMessage
   Wrap32 seqno { 0 };
 
   bool SYN {};
-  std::string payload {};
+  Buffer payload {};
   bool FIN {};
 
   bool RST {};
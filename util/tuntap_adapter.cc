@@ -5,17 +5,22 @@ using namespace std;
 
 optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
 {
-  vector<string> strs( 2 );
-  strs.front().resize( IPv4Header::LENGTH );
+  // Scatter the IPv4 header, TCP header and payload into their own buffers. Each header then consumes
+  // exactly one buffer, and the payload buffer is moved (not copied) all the way into the TCPMessage.
+  vector<string> strs( 3 );
+  strs.at( 0 ).resize( IPv4Header::LENGTH );
+  strs.at( 1 ).resize( TCPSegment::HEADER_LENGTH );
   _tun.read( strs );
 
   InternetDatagram ip_dgram;
-  const vector<string> buffers = { strs.at( 0 ), strs.at( 1 ) };
-  if ( parse( ip_dgram, buffers ) ) {
-    return unwrap_tcp_in_ip( ip_dgram );
+  if ( parse( ip_dgram, std::move( strs ) ) ) {
+    return unwrap_tcp_in_ip( std::move( ip_dgram ) );
   }
   return {};
 }
 
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
 template class LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
+
+//! Specialize NetemFdAdapter to TCPOverIPv4OverTunFdAdapter
+template class NetemFdAdapter<TCPOverIPv4OverTunFdAdapter>;
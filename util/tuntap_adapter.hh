@@ -1,5 +1,6 @@
 #pragma once
 
+#include "netem_fd_adapter.hh"
 #include "tcp_over_ip.hh"
 #include "tcp_segment.hh"
 #include "tun.hh"
@@ -27,8 +28,13 @@ private:
   TunFD _tun;
 
 public:
-  //! Construct from a TunFD
-  explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( std::move( tun ) ) {}
+  //! \brief Construct from a TunFD
+  //! \details Segments read from the TUN device may be for other connections, so their checksums are only verified
+  //! once they are known to be for this one (ChecksumPolicy::Defer).
+  explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( std::move( tun ) )
+  {
+    set_checksum_policy( ChecksumPolicy::Defer );
+  }
 
   //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
   std::optional<TCPMessage> read();
@@ -48,3 +54,4 @@ public:
 
 static_assert( TCPDatagramAdapter<TCPOverIPv4OverTunFdAdapter> );
 static_assert( TCPDatagramAdapter<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>> );
+static_assert( TCPDatagramAdapter<NetemFdAdapter<TCPOverIPv4OverTunFdAdapter>> );